@@ -37,6 +37,13 @@ namespace nap
 		if (!error.check(mActionController != nullptr, "Unable to find ActionController"))
 			return false;
 
+		mController = mResourceManager->findObject<edit::Controller>("Controller");
+		if (!error.check(mController != nullptr, "Unable to find Controller"))
+			return false;
+
+		// The journal is optional, without it there is no crash recovery
+		mJournal = mResourceManager->findObject<edit::Journal>("Journal");
+
 		mWindow = mResourceManager->findObject<gui::GuiWindow>("MainWindow");
 		if (!error.check(mWindow != nullptr, "unable to find main window gui"))
 			return false;
@@ -98,6 +105,9 @@ namespace nap
 
 	int CoreApp::shutdown()
 	{
+		// A clean exit leaves nothing to recover
+		if (mJournal != nullptr)
+			mJournal->close();
 		return 0;
 	}
 
@@ -110,8 +120,14 @@ namespace nap
 		nap::DefaultInputRouter input_router(true);
 		mInputService->processWindowEvents(*mRenderWindow, input_router, { &mScene->getRootEntity() });
 
+		// Apply edits posted from other threads before the gui reads the model
+		mController->processQueue();
+
 		mWindow->show();
 
+		if (mJournal != nullptr)
+			mJournal->update();
+
 		if (mActionController->isQuitting())
 			quit();
 	}
@@ -75,6 +75,8 @@ namespace nap
 
     private:
     	ResourcePtr<edit::ActionController> mActionController = nullptr;
+    	ResourcePtr<edit::Journal> mJournal = nullptr;
+    	ResourcePtr<edit::Controller> mController = nullptr;
     	ResourcePtr<gui::GuiWindow> mWindow = nullptr;
 
         ResourceManager*			mResourceManager = nullptr;		///< Manages all the loaded data
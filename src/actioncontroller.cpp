@@ -13,6 +13,7 @@ RTTI_BEGIN_CLASS(nap::edit::ActionController)
     RTTI_PROPERTY("QuitAction", &nap::edit::ActionController::mQuitAction, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("UndoAction", &nap::edit::ActionController::mUndoAction, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("RedoAction", &nap::edit::ActionController::mRedoAction, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("Journal", &nap::edit::ActionController::mJournal, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 
@@ -32,6 +33,25 @@ namespace nap
             mQuitAction->performSignal.connect(mQuitActionSlot);
             mUndoAction->performSignal.connect(mUndoActionSlot);
             mRedoAction->performSignal.connect(mRedoActionSlot);
+
+            if (mJournal != nullptr)
+            {
+                // The previous session did not exit cleanly, restore its work
+                if (mJournal->hasRecovery())
+                {
+                    utility::ErrorState recoveryErrorState;
+                    if (mJournal->recover(mPath, recoveryErrorState))
+                        Logger::info("Recovered unsaved changes from %s", mJournal->mPath.c_str());
+                    else
+                    {
+                        Logger::error("Failed to recover unsaved changes: %s", recoveryErrorState.toString().c_str());
+                        mJournal->compact(mPath);
+                    }
+                }
+                else
+                    mJournal->compact(mPath);
+            }
+
             return true;
         }
 
@@ -41,6 +61,8 @@ namespace nap
             mModel->clear();
             mPath.clear();
             mSelector->clear();
+            if (mJournal != nullptr)
+                mJournal->compact(mPath);
         }
 
 
@@ -51,6 +73,8 @@ namespace nap
                 utility::ErrorState errorState;
                 if (!mModel->loadFromFile(mPath, errorState))
                     Logger::error(errorState.toString().c_str());
+                else if (mJournal != nullptr)
+                    mJournal->compact(mPath);
                 mSelector->clear();
             }
         }
@@ -61,20 +85,24 @@ namespace nap
             if (mPath.empty())
                 if (utility::saveFileDialog("json", utility::getCWD(), mPath) != utility::FileDialogResult::Ok)
                     return;
-            utility::ErrorState errorState;
-            if (!mModel->saveToFile(mPath, errorState))
-                Logger::error(errorState.toString().c_str());
+            save();
         }
 
 
         void ActionController::onSaveAsAction(gui::Action&)
         {
-            if (utility::saveFileDialog("json", utility::getCWD(), mPath) != utility::FileDialogResult::Ok)
-            {
-                utility::ErrorState errorState;
-                if (!mModel->saveToFile(mPath, errorState))
-                    Logger::error(errorState.toString().c_str());
-            }
+            if (utility::saveFileDialog("json", utility::getCWD(), mPath) == utility::FileDialogResult::Ok)
+                save();
+        }
+
+
+        void ActionController::save()
+        {
+            utility::ErrorState errorState;
+            if (!mModel->saveToFile(mPath, errorState))
+                Logger::error(errorState.toString().c_str());
+            else if (mJournal != nullptr)
+                mJournal->compact(mPath);
         }
 
 
@@ -2,6 +2,7 @@
 
 #include <model.h>
 #include <controller.h>
+#include <journal.h>
 #include <Gui/Action.h>
 
 namespace nap
@@ -28,6 +29,7 @@ namespace nap
 
             ResourcePtr<Selector> mSelector;
             ResourcePtr<Controller> mController;
+            ResourcePtr<Journal> mJournal;
 
             bool init(utility::ErrorState& errorState) override;
 
@@ -51,6 +53,9 @@ namespace nap
             Slot<gui::Action&> mRedoActionSlot = { this, &ActionController::onRedoAction };
             void onRedoAction(gui::Action&);
 
+            // Saves the model to mPath and compacts the journal
+            void save();
+
             std::string mPath;
             ResourcePtr<Model> mModel;
             bool mQuitting = false;
@@ -0,0 +1,80 @@
+#include "allocationcounter.h"
+
+#ifdef NAPEDIT_COUNT_ALLOCATIONS
+
+#include <imgui.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> allocationCount = { 0 };
+
+
+	// ImGui allocates through its own allocator functions instead of operator new
+	void* allocateImGui(size_t size, void*)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size);
+	}
+
+
+	void freeImGui(void* pointer, void*)
+	{
+		std::free(pointer);
+	}
+
+
+	// Installed during static initialization. The default ImGui allocator also uses malloc and free,
+	// so memory ImGui allocated before this hook is installed is still freed correctly.
+	struct ImGuiAllocatorHook
+	{
+		ImGuiAllocatorHook() { ImGui::SetAllocatorFunctions(allocateImGui, freeImGui, nullptr); }
+	} imguiAllocatorHook;
+}
+
+
+// The array and nothrow forms of new and delete forward to these by default
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	auto pointer = std::malloc(size == 0 ? 1 : size);
+	if (pointer == nullptr)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+#endif // NAPEDIT_COUNT_ALLOCATIONS
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		uint64_t getAllocationCount()
+		{
+#ifdef NAPEDIT_COUNT_ALLOCATIONS
+			return allocationCount.load(std::memory_order_relaxed);
+#else
+			return 0;
+#endif
+		}
+
+	}
+
+}
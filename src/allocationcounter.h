@@ -0,0 +1,24 @@
+#pragma once
+
+#include <utility/dllexport.h>
+
+#include <cstdint>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Debug counter of heap allocations, used to verify that drawing the GUI in a steady state does not allocate.
+		 * Allocations are only counted when napedit is built with NAPEDIT_COUNT_ALLOCATIONS defined, which replaces the global operator new
+		 * and installs counting allocator functions in ImGui.
+		 * On Windows every DLL has its own operator new, so only allocations made by code in the napedit module itself are counted there.
+		 * Allocations in NAP and other modules, for instance by std containers instantiated in their code, are missed.
+		 * ImGui allocations are counted as long as ImGui is linked as a single copy that napedit shares.
+		 * @return Number of heap allocations since the start of the program, always 0 when counting is disabled.
+		 */
+		NAPAPI uint64_t getAllocationCount();
+
+	}
+}
@@ -0,0 +1,75 @@
+#include "commandqueue.h"
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		CommandQueue::CommandQueue() : mHead(&mStub), mTail(&mStub)
+		{
+		}
+
+
+		CommandQueue::~CommandQueue()
+		{
+			Command command;
+			while (pop(command))
+				;
+		}
+
+
+		void CommandQueue::push(Command command)
+		{
+			auto node = new Node;
+			node->mCommand = std::move(command);
+			push(node);
+		}
+
+
+		void CommandQueue::push(Node* node)
+		{
+			node->mNext.store(nullptr, std::memory_order_relaxed);
+			auto previous = mHead.exchange(node, std::memory_order_acq_rel);
+			// Between the exchange and this store the node is not reachable from the tail yet, pop() treats that as empty
+			previous->mNext.store(node, std::memory_order_release);
+		}
+
+
+		bool CommandQueue::pop(Command& command)
+		{
+			auto tail = mTail;
+			auto next = tail->mNext.load(std::memory_order_acquire);
+
+			// Skip the stub
+			if (tail == &mStub)
+			{
+				if (next == nullptr)
+					return false;
+				mTail = next;
+				tail = next;
+				next = next->mNext.load(std::memory_order_acquire);
+			}
+
+			if (next == nullptr)
+			{
+				// The tail is the last node, or a producer is halfway through pushing after it
+				if (tail != mHead.load(std::memory_order_acquire))
+					return false;
+
+				// Put the stub back behind the tail so that the tail can be taken out
+				push(&mStub);
+				next = tail->mNext.load(std::memory_order_acquire);
+				if (next == nullptr)
+					return false;
+			}
+
+			mTail = next;
+			command = std::move(tail->mCommand);
+			delete tail;
+			return true;
+		}
+
+	}
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <utility/dllexport.h>
+
+#include <atomic>
+#include <functional>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		class Controller;
+
+		/**
+		 * Lock-free multi producer, single consumer queue of commands for the Controller.
+		 * Any thread can push commands, only the thread that owns the Controller pops them.
+		 * Pushing never blocks: a push is one allocation and one atomic exchange.
+		 */
+		class NAPAPI CommandQueue
+		{
+		public:
+			using Command = std::function<void(Controller&)>;
+
+			CommandQueue();
+			~CommandQueue();
+			CommandQueue(const CommandQueue&) = delete;
+			CommandQueue& operator=(const CommandQueue&) = delete;
+
+			/**
+			 * Adds a command to the queue. Can be called from any thread.
+			 * @param command The command, called with the Controller on the consumer thread.
+			 */
+			void push(Command command);
+
+			/**
+			 * Removes the oldest command from the queue. Only call from the consumer thread.
+			 * Returns false when the queue is empty, or when the oldest command is still being pushed by another thread.
+			 * @param command Receives the command.
+			 * @return True if a command was popped.
+			 */
+			bool pop(Command& command);
+
+		private:
+			struct Node
+			{
+				std::atomic<Node*> mNext = { nullptr };
+				Command mCommand;
+			};
+
+			void push(Node* node);
+
+			std::atomic<Node*> mHead;	// Most recently pushed node, producers exchange it
+			Node* mTail;				// Oldest node, only accessed by the consumer
+			Node mStub;					// Keeps the list non-empty so producers and consumer never touch the same pointer
+		};
+
+	}
+}
@@ -1,7 +1,20 @@
 #include "controller.h"
+#include "snapshot.h"
+#include "objectutils.h"
+
+#include <nap/logger.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <unordered_set>
 
 RTTI_BEGIN_CLASS(nap::edit::Controller)
     RTTI_PROPERTY("Model", &nap::edit::Controller::mModel, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("UndoMemoryBudget", &nap::edit::Controller::mUndoMemoryBudget, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("UndoSpillPath", &nap::edit::Controller::mUndoSpillPath, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("QueueTimeBudget", &nap::edit::Controller::mQueueTimeBudget, nap::rtti::EPropertyMetaData::Default)
 RTTI_END_CLASS
 
 namespace nap
@@ -10,6 +23,23 @@ namespace nap
     namespace edit
     {
 
+        namespace
+        {
+            // Undo data smaller than this stays in memory as variants, a spill block costs more than it saves
+            constexpr size_t minimumSpillSize = 256;
+        }
+
+
+        bool Controller::init(utility::ErrorState &errorState)
+        {
+            if (!errorState.check(mUndoMemoryBudget > 0, "UndoMemoryBudget must be positive"))
+                return false;
+            mSpillStore.setPath(mUndoSpillPath);
+            mSpillStore.setBudget(size_t(mUndoMemoryBudget) * 1024 * 1024);
+            return true;
+        }
+
+
         bool Controller::renameResource(const std::string &oldID, const std::string &newID)
         {
             if (newID.empty())
@@ -70,11 +100,125 @@ namespace nap
 
         void Controller::removeResource(const std::string &mID)
         {
-            auto type = mModel->findResource(mID)->get_type();
+            // Capture the resource with its embedded objects, tree position and inbound pointers so that undo restores it exactly
+            auto snapshot = std::make_shared<Snapshot>();
+            utility::ErrorState errorState;
+            if (!snapshot->capture(*mModel, mID, mSpillStore, errorState))
+            {
+                Logger::error("Failed to remove %s: %s", mID.c_str(), errorState.toString().c_str());
+                return;
+            }
+
+            auto derivations = mModel->getDerivations({ mID });
+            snapshot->unlink(*mModel);
             mModel->removeResource(mID);
             addUndoStack(
-                [this, mID]{ mModel->removeResource(mID); },
-                [this, mID, type]{ mModel->createResource(type, mID); }
+                [this, mID, snapshot]
+                {
+                    snapshot->unlink(*mModel);
+                    mModel->removeResource(mID);
+                },
+                [this, snapshot, derivations]
+                {
+                    utility::ErrorState errorState;
+                    if (!snapshot->restore(*mModel, errorState))
+                        Logger::error("Failed to restore %s: %s", snapshot->getRootID().c_str(), errorState.toString().c_str());
+                    mModel->restoreDerivations(derivations);
+                }
+            );
+        }
+
+
+        void Controller::removeResources(const std::vector<std::string>& mIDs)
+        {
+            // Resources embedded in another removed resource are captured and restored as part of it
+            std::unordered_set<Resource*> embedded;
+            for (auto& mID : mIDs)
+            {
+                auto resource = mModel->findResource(mID);
+                assert(resource != nullptr);
+                std::unordered_set<Resource*> objects;
+                mModel->collectEmbeddedObjects(*resource, objects);
+                objects.erase(resource);
+                embedded.insert(objects.begin(), objects.end());
+            }
+            std::vector<std::string> roots;
+            std::unordered_set<std::string> unique;
+            for (auto& mID : mIDs)
+                if (embedded.find(mModel->findResource(mID)) == embedded.end() && unique.emplace(mID).second)
+                    roots.emplace_back(mID);
+
+            if (roots.size() == 1)
+            {
+                removeResource(roots.front());
+                return;
+            }
+            if (roots.empty())
+                return;
+
+            // Capture all resources in a single pass over the model, each snapshot only contains pointers to resources restored before it
+            auto snapshots = std::make_shared<std::vector<Snapshot>>();
+            utility::ErrorState errorState;
+            if (!Snapshot::capture(*mModel, roots, mSpillStore, *snapshots, errorState))
+            {
+                Logger::error("Failed to remove resources: %s", errorState.toString().c_str());
+                return;
+            }
+
+            auto derivations = mModel->getDerivations(roots);
+            mModel->removeResources(roots);
+            addUndoStack(
+                [this, roots, snapshots]
+                {
+                    for (auto& snapshot : *snapshots)
+                        snapshot.unlink(*mModel);
+                    mModel->removeResources(roots);
+                },
+                [this, snapshots, derivations]
+                {
+                    for (auto it = snapshots->rbegin(); it != snapshots->rend(); ++it)
+                    {
+                        utility::ErrorState errorState;
+                        if (!it->restore(*mModel, errorState))
+                            Logger::error("Failed to restore %s: %s", it->getRootID().c_str(), errorState.toString().c_str());
+                    }
+                    mModel->restoreDerivations(derivations);
+                }
+            );
+        }
+
+
+        std::vector<std::string> Controller::duplicate(const std::vector<std::string>& mIDs)
+        {
+            if (mIDs.empty())
+                return {};
+
+            // Redo recreates the copies with the ids generated now
+            auto copyIDs = std::make_shared<std::vector<std::string>>();
+            auto result = mModel->duplicateResources(mIDs, *copyIDs);
+            addUndoStack(
+                [this, mIDs, copyIDs]{ mModel->duplicateResources(mIDs, *copyIDs); },
+                [this, copyIDs]{ mModel->removeResources(*copyIDs); }
+            );
+            return result;
+        }
+
+
+        void Controller::moveResources(const std::vector<std::string>& mIDs, const std::string& groupID)
+        {
+            // Only resources in the tree can be moved, their current locations are kept for undo
+            auto locations = mModel->getTreeLocations(mIDs);
+            if (locations.empty())
+                return;
+            std::vector<std::string> moved;
+            moved.reserve(locations.size());
+            for (auto& location : locations)
+                moved.emplace_back(location.mID);
+
+            mModel->moveResources(moved, groupID);
+            addUndoStack(
+                [this, moved, groupID]{ mModel->moveResources(moved, groupID); },
+                [this, locations]{ mModel->restoreTreeLocations(locations); }
             );
         }
 
@@ -100,6 +244,126 @@ namespace nap
         }
 
 
+        std::vector<std::string> Controller::createResources(const rtti::TypeInfo& type, int count, const std::string& pattern, const std::string& parentID, const std::string& templateID)
+        {
+            if (count <= 0)
+                return {};
+
+            // Copy the template values once, they are assigned to every new resource
+            auto values = std::make_shared<Model::PropertyValues>();
+            if (!templateID.empty())
+            {
+                auto source = mModel->findResource(templateID);
+                assert(source != nullptr && source->get_type() == type);
+                for (auto& property : type.get_properties())
+                {
+                    if (property.get_name() == "mID" || rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded))
+                        continue;
+                    values->emplace_back(property, property.get_value(*source));
+                }
+            }
+
+            auto mIDs = std::make_shared<std::vector<std::string>>(mModel->getUniqueIDs(pattern.empty() ? type.get_name().to_string() : pattern, count));
+            mModel->createResources(type, *mIDs, parentID, *values);
+            addUndoStack(
+                [this, type, mIDs, parentID, values]{ mModel->createResources(type, *mIDs, parentID, *values); },
+                [this, mIDs]{ mModel->removeResources(*mIDs); }
+            );
+            return *mIDs;
+        }
+
+
+        bool Controller::setTemplate(const std::string& mID, const std::string& templateID)
+        {
+            auto resource = mModel->findResource(mID);
+            assert(resource != nullptr);
+            auto previous = mModel->getDerivations({ mID });
+            previous.erase(std::remove_if(previous.begin(), previous.end(), [&](const auto& derivation){ return derivation.first != mID; }), previous.end());
+
+            if (templateID.empty())
+            {
+                if (previous.empty())
+                    return false;
+                mModel->clearTemplate(mID);
+                addUndoStack(
+                    [this, mID]{ mModel->clearTemplate(mID); },
+                    [this, previous]{ mModel->restoreDerivations(previous); }
+                );
+                return true;
+            }
+
+            // Properties that differ from the template are overrides, so deriving does not change any values
+            auto source = mModel->findResource(templateID);
+            assert(source != nullptr);
+            if (source->get_type() != resource->get_type())
+                return false;
+            std::unordered_set<std::string> overrides;
+            for (auto& property : resource->get_type().get_properties())
+                if (property.get_name() != "mID" && !rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded))
+                    if (!(property.get_value(*resource) == property.get_value(*source)))
+                        overrides.emplace(property.get_name().to_string());
+
+            if (!mModel->setTemplate(mID, templateID, overrides))
+                return false;
+            addUndoStack(
+                [this, mID, templateID, overrides]{ mModel->setTemplate(mID, templateID, overrides); },
+                [this, mID, previous]
+                {
+                    mModel->clearTemplate(mID);
+                    mModel->restoreDerivations(previous);
+                }
+            );
+            return true;
+        }
+
+
+        std::string Controller::createDerived(const std::string& templateID)
+        {
+            auto source = mModel->findResource(templateID);
+            assert(source != nullptr && !source->get_type().is_derived_from(RTTI_OF(Component)));
+
+            // The new resource is placed in the same group as the template
+            std::string parentID;
+            auto locations = mModel->getTreeLocations({ templateID });
+            if (!locations.empty())
+                parentID = locations.front().mParentID;
+
+            auto mID = mModel->getUniqueIDs(templateID, 1).front();
+            mModel->createResources(source->get_type(), { mID }, parentID, {});
+            mModel->setTemplate(mID, templateID, {});
+            addUndoStack(
+                [this, mID, templateID, parentID]
+                {
+                    auto source = mModel->findResource(templateID);
+                    mModel->createResources(source->get_type(), { mID }, parentID, {});
+                    mModel->setTemplate(mID, templateID, {});
+                },
+                [this, mID]{ mModel->removeResources({ mID }); }
+            );
+            return mID;
+        }
+
+
+        void Controller::revertOverride(const std::string& mID, const std::string& propertyName)
+        {
+            auto resource = mModel->findResource(mID);
+            assert(resource != nullptr);
+            auto property = resource->get_type().get_property(propertyName);
+            assert(property.is_valid());
+            auto oldValue = property.get_value(*resource);
+            mModel->revertOverride(mID, propertyName);
+            addUndoStack(
+                [this, mID, propertyName]{ mModel->revertOverride(mID, propertyName); },
+                [this, mID, propertyName, oldValue]
+                {
+                    auto resource = mModel->findResource(mID);
+                    resource->get_type().get_property(propertyName).set_value(*resource, oldValue);
+                    mModel->propertyChanged(mID, propertyName);
+                }
+            );
+        }
+
+
         void Controller::createGroup(const rtti::TypeInfo &type, const std::string &parentID)
         {
             auto mID = mModel->createGroup(type, type.get_name().to_string());
@@ -157,6 +421,7 @@ namespace nap
             assert(resource != nullptr);
             auto mID = resource->mID;
 
+            bool overridden = isOverridden(path);
             if (path.isPointer())
                 path.getResolvedPath().setValue(resource);
             else if (path.isArrayElement() || path.isArray())
@@ -171,13 +436,14 @@ namespace nap
                     else if (path.isArrayElement() || path.isArray())
                         doInsertArrayElement(path, resource);
                 },
-                [this, path, mID]() mutable
+                [this, path, mID, overridden]() mutable
                 {
                     if (path.isPointer())
                         path.getResolvedPath().setValue(nullptr);
                     else if (path.isArrayElement() || path.isArray())
                         doRemoveArrayElement(path);
                     mModel->removeResource(mID);
+                    restoreOverride(path, overridden);
                 }
             );
         }
@@ -213,16 +479,20 @@ namespace nap
             assert(elementType.can_create_instance());
             auto element = elementType.create();
 
+            bool overridden = isOverridden(path);
             doInsertArrayElement(path, element);
 
             addUndoStack(
                 [this, path, element]() mutable
                 {
+                    path.resolve(*mModel);
                     doInsertArrayElement(path, element);
                 },
-                [this, path]() mutable
+                [this, path, overridden]() mutable
                 {
+                    path.resolve(*mModel);
                     doRemoveArrayElement(path);
+                    restoreOverride(path, overridden);
                 }
             );
         }
@@ -230,7 +500,10 @@ namespace nap
 
         void Controller::removeArrayElement(ValuePath &path)
         {
-            auto element = path.getResolvedPath().getValue();
+            // Only the removed element is kept for undo
+            assert(path.isArrayElement());
+            auto element = path.getValue();
+            bool overridden = isOverridden(path);
             doRemoveArrayElement(path);
             addUndoStack(
                 [this, path]() mutable
@@ -238,10 +511,11 @@ namespace nap
                     path.resolve(*mModel);
                     doRemoveArrayElement(path);
                 },
-                [this, path, element]() mutable
+                [this, path, element, overridden]() mutable
                 {
                     path.resolve(*mModel);
                     doInsertArrayElement(path, element);
+                    restoreOverride(path, overridden);
                 }
             );
         }
@@ -251,18 +525,22 @@ namespace nap
         {
             auto oldIndex = path.getArrayIndex();
             auto newIndex = path.getArrayIndex() - 1;
+            bool overridden = isOverridden(path);
             if (!doMoveArrayElementUp(path))
                 return;
             addUndoStack(
                 [this, path, oldIndex]() mutable
                 {
+                    path.resolve(*mModel);
                     path.set(oldIndex);
                     doMoveArrayElementUp(path);
                 },
-                [this, path, newIndex]() mutable
+                [this, path, newIndex, overridden]() mutable
                 {
+                    path.resolve(*mModel);
                     path.set(newIndex);
                     doMoveArrayElementDown(path);
+                    restoreOverride(path, overridden);
                 }
             );
         }
@@ -272,34 +550,275 @@ namespace nap
         {
             auto oldIndex = path.getArrayIndex();
             auto newIndex = path.getArrayIndex() + 1;
+            bool overridden = isOverridden(path);
             if (!doMoveArrayElementDown(path))
                 return;
             addUndoStack(
                 [this, path, oldIndex]() mutable
                 {
+                    path.resolve(*mModel);
                     path.set(oldIndex);
                     doMoveArrayElementDown(path);
                 },
-                [this, path, newIndex]() mutable
+                [this, path, newIndex, overridden]() mutable
                 {
+                    path.resolve(*mModel);
                     path.set(newIndex);
                     doMoveArrayElementUp(path);
+                    restoreOverride(path, overridden);
                 }
             );
         }
 
 
-        void Controller::doRemoveArrayElement(ValuePath &path)
+        void Controller::removeArrayElements(ValuePath &path, int first, int last)
         {
+            if (first >= last)
+                return;
+            bool overridden = isOverridden(path);
+            // The removed elements are kept in the spill store
+            auto removed = spillValues(doRemoveArrayElements(path, first, last));
+            auto count = last - first;
+            addUndoStack(
+                [this, path, first, last]() mutable
+                {
+                    path.resolve(*mModel);
+                    doRemoveArrayElements(path, first, last);
+                },
+                [this, path, first, count, removed, overridden]() mutable
+                {
+                    path.resolve(*mModel);
+
+                    // A default element provides the type the removed elements are read as
+                    auto array = path.getResolvedPath().getValue();
+                    auto view = array.create_array_view();
+                    view.set_size(view.get_size() + 1);
+                    std::vector<rtti::Variant> elements(count, view.get_value(view.get_size() - 1));
+                    if (loadValues(removed, elements))
+                        doInsertArrayElements(path, first, elements);
+                    restoreOverride(path, overridden);
+                }
+            );
+        }
+
+
+        void Controller::insertArrayElements(ValuePath &path, int index, int count)
+        {
+            if (count <= 0)
+                return;
+            auto array = path.getResolvedPath().getValue();
+            auto elementType = array.create_array_view().get_rank_type(1);
+            assert(elementType.can_create_instance());
+            auto elements = std::make_shared<std::vector<rtti::Variant>>();
+            elements->reserve(count);
+            for (auto i = 0; i < count; ++i)
+                elements->emplace_back(elementType.create());
+
+            bool overridden = isOverridden(path);
+            doInsertArrayElements(path, index, *elements);
+            addUndoStack(
+                [this, path, index, elements]() mutable
+                {
+                    path.resolve(*mModel);
+                    doInsertArrayElements(path, index, *elements);
+                },
+                [this, path, index, count, overridden]() mutable
+                {
+                    path.resolve(*mModel);
+                    doRemoveArrayElements(path, index, index + count);
+                    restoreOverride(path, overridden);
+                }
+            );
+        }
+
+
+        void Controller::moveArrayElements(ValuePath &path, int first, int last, int target)
+        {
+            if (first >= last || first == target)
+                return;
+            bool overridden = isOverridden(path);
+            doMoveArrayElements(path, first, last, target);
+            auto count = last - first;
+            addUndoStack(
+                [this, path, first, last, target]() mutable
+                {
+                    path.resolve(*mModel);
+                    doMoveArrayElements(path, first, last, target);
+                },
+                [this, path, first, target, count, overridden]() mutable
+                {
+                    path.resolve(*mModel);
+                    doMoveArrayElements(path, target, target + count, first);
+                    restoreOverride(path, overridden);
+                }
+            );
+        }
+
+
+        bool Controller::isSortKey(const rtti::TypeInfo& type)
+        {
+            return type.is_arithmetic() || type.is_enumeration() || type == RTTI_OF(std::string);
+        }
+
+
+        void Controller::sortArray(ValuePath &path, const std::string &key)
+        {
+            // Gather the sort keys in one pass over the array
             auto array = path.getResolvedPath().getValue();
             auto view = array.create_array_view();
-            if (path.isArrayElement())
+            auto size = int(view.get_size());
+            std::vector<rtti::Variant> keys;
+            keys.reserve(size);
+            auto keyProperty = view.get_rank_type(1).get_property(key);
+            assert(key.empty() || keyProperty.is_valid());
+
+            // Other types have no registered comparison, sorting them would record a command that does nothing
+            auto keyType = keyProperty.is_valid() ? keyProperty.get_type() : view.get_rank_type(1);
+            if (!isSortKey(keyType))
             {
-                view.remove_value(path.getArrayIndex());
+                Logger::warn("Can not sort by values of type %s", keyType.get_name().to_string().c_str());
+                return;
             }
-            else if (path.isArray())
-                view.remove_value(view.get_size() - 1);
-            path.getResolvedPath().setValue(array);
+
+            for (auto i = 0; i < size; ++i)
+                keys.emplace_back(keyProperty.is_valid() ? keyProperty.get_value(view.get_value(i)) : view.get_value(i));
+
+            // The undo entry only stores the permutation, not the elements
+            std::vector<int> order(size);
+            std::iota(order.begin(), order.end(), 0);
+            std::stable_sort(order.begin(), order.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+            if (std::is_sorted(order.begin(), order.end()))
+                return;
+
+            bool overridden = isOverridden(path);
+            doPermuteArray(path, order);
+
+            // Large permutations go to the spill store, the inverse is derived when undoing
+            auto bytes = reinterpret_cast<const uint8_t*>(order.data());
+            auto block = mSpillStore.store(std::vector<uint8_t>(bytes, bytes + order.size() * sizeof(int)));
+            auto loadOrder = [this, block](std::vector<int>& order)
+            {
+                utility::ErrorState errorState;
+                auto data = mSpillStore.load(*block, errorState);
+                if (data == nullptr)
+                {
+                    Logger::error(errorState.toString().c_str());
+                    return false;
+                }
+                order.resize(data->size() / sizeof(int));
+                std::memcpy(order.data(), data->data(), data->size());
+                return true;
+            };
+            addUndoStack(
+                [this, path, loadOrder]() mutable
+                {
+                    std::vector<int> order;
+                    if (!loadOrder(order))
+                        return;
+                    path.resolve(*mModel);
+                    doPermuteArray(path, order);
+                },
+                [this, path, loadOrder, overridden]() mutable
+                {
+                    std::vector<int> order;
+                    if (!loadOrder(order))
+                        return;
+                    std::vector<int> inverse(order.size());
+                    for (auto i = 0; i < order.size(); ++i)
+                        inverse[order[i]] = i;
+                    path.resolve(*mModel);
+                    doPermuteArray(path, inverse);
+                    restoreOverride(path, overridden);
+                }
+            );
+        }
+
+
+        void Controller::doInsertArrayElements(ValuePath &path, int index, const std::vector<rtti::Variant> &elements)
+        {
+            modifyArray(path, [&](auto& view)
+            {
+                // Grow once, shift the tail back in one pass and fill the gap
+                int size = view.get_size();
+                int count = elements.size();
+                assert(view.is_dynamic());
+                assert(index >= 0 && index <= size);
+                view.set_size(size + count);
+                for (auto i = size - 1; i >= index; --i)
+                    view.set_value(i + count, view.get_value(i));
+                for (auto i = 0; i < count; ++i)
+                    view.set_value(index + i, elements[i]);
+            });
+        }
+
+
+        std::vector<rtti::Variant> Controller::doRemoveArrayElements(ValuePath &path, int first, int last)
+        {
+            std::vector<rtti::Variant> removed;
+            modifyArray(path, [&](auto& view)
+            {
+                // Keep the removed elements, shift the tail forward in one pass and shrink once
+                int size = view.get_size();
+                assert(view.is_dynamic());
+                assert(first >= 0 && first <= last && last <= size);
+                int count = last - first;
+                removed.reserve(count);
+                for (auto i = first; i < last; ++i)
+                    removed.emplace_back(view.get_value(i));
+                for (auto i = first; i < size - count; ++i)
+                    view.set_value(i, view.get_value(i + count));
+                view.set_size(size - count);
+            });
+            return removed;
+        }
+
+
+        void Controller::doMoveArrayElements(ValuePath &path, int first, int last, int target)
+        {
+            modifyArray(path, [&](auto& view)
+            {
+                // Rotate only the part of the array between the old and new position of the block
+                int count = last - first;
+                assert(target >= 0 && target + count <= int(view.get_size()));
+                int begin = std::min(first, target);
+                int end = std::max(last, target + count);
+                std::vector<rtti::Variant> range;
+                range.reserve(end - begin);
+                for (auto i = begin; i < end; ++i)
+                    range.emplace_back(view.get_value(i));
+                if (target < first)
+                    std::rotate(range.begin(), range.begin() + (first - begin), range.end());
+                else
+                    std::rotate(range.begin(), range.begin() + count, range.end());
+                for (auto i = begin; i < end; ++i)
+                    view.set_value(i, range[i - begin]);
+            });
+        }
+
+
+        void Controller::doPermuteArray(ValuePath &path, const std::vector<int> &order)
+        {
+            modifyArray(path, [&](auto& view)
+            {
+                std::vector<rtti::Variant> elements;
+                elements.reserve(order.size());
+                for (auto i = 0; i < order.size(); ++i)
+                    elements.emplace_back(view.get_value(i));
+                for (auto i = 0; i < order.size(); ++i)
+                    view.set_value(i, elements[order[i]]);
+            });
+        }
+
+
+        void Controller::doRemoveArrayElement(ValuePath &path)
+        {
+            modifyArray(path, [&](auto& view)
+            {
+                if (path.isArrayElement())
+                    view.remove_value(path.getArrayIndex());
+                else if (path.isArray())
+                    view.remove_value(view.get_size() - 1);
+            });
         }
 
 
@@ -307,63 +826,489 @@ namespace nap
         {
             if (path.getArrayIndex() < 1)
                 return false;
-            auto array = path.getResolvedPath().getValue();
-            auto view = array.create_array_view();
-            auto size = view.get_size();
-            assert(path.getArrayIndex() < size);
-            auto element = view.get_value(path.getArrayIndex());
-            view.remove_value(path.getArrayIndex());
-            view.insert_value(path.getArrayIndex() - 1, element);
-            path.getResolvedPath().setValue(array);
+
+            // Swap with the previous element instead of removing and inserting, which would shift the array twice
+            auto index = path.getArrayIndex();
+            modifyArray(path, [index](auto& view)
+            {
+                assert(index < view.get_size());
+                auto element = view.get_value(index);
+                view.set_value(index, view.get_value(index - 1));
+                view.set_value(index - 1, element);
+            });
             return true;
         }
 
 
         bool Controller::doMoveArrayElementDown(ValuePath &path)
         {
-            auto array = path.getResolvedPath().getValue();
-            auto view = array.create_array_view();
-            auto size = view.get_size();
-            assert(path.getArrayIndex() < size);
-            if (path.getArrayIndex() == size - 1)
-                return false;
-            auto element = view.get_value(path.getArrayIndex());
-            view.remove_value(path.getArrayIndex());
-            view.insert_value(path.getArrayIndex() + 1, element);
-            path.getResolvedPath().setValue(array);
-            return true;
+            auto index = path.getArrayIndex();
+            bool moved = false;
+            modifyArray(path, [index, &moved](auto& view)
+            {
+                assert(index < view.get_size());
+                if (index == view.get_size() - 1)
+                    return;
+                auto element = view.get_value(index);
+                view.set_value(index, view.get_value(index + 1));
+                view.set_value(index + 1, element);
+                moved = true;
+            });
+            return moved;
+        }
+
+
+        void Controller::beginEdit(const ValuePath &path)
+        {
+            if (isEditing(path))
+                return;
+            beginEdit(std::vector<ValuePath>({ path }));
+        }
+
+
+        void Controller::beginEdit(const std::vector<ValuePath>& paths)
+        {
+            if (isEditing(paths))
+                return;
+            commitEdit();
+            mEditSession = std::make_unique<EditSession>(paths);
+            mEditSession->mOldValues.reserve(paths.size());
+            mEditSession->mOverridden.reserve(paths.size());
+            for (auto& path : mEditSession->mPaths)
+            {
+                path.resolve(*mModel);
+                mEditSession->mOldValues.emplace_back(path.getValue());
+                mEditSession->mOverridden.emplace_back(isOverridden(path));
+            }
+        }
+
+
+        void Controller::updateEdit(const ValuePath &path, const rtti::Variant &value)
+        {
+            if (!isEditing(path))
+                beginEdit(path);
+            applyEdit(value);
+        }
+
+
+        void Controller::updateEdit(const std::vector<ValuePath>& paths, const rtti::Variant& value)
+        {
+            if (!isEditing(paths))
+                beginEdit(paths);
+            applyEdit(value);
+        }
+
+
+        void Controller::applyEdit(const rtti::Variant& value)
+        {
+            // Apply the intermediate value directly through the paths resolved at the start of the session
+            for (auto& path : mEditSession->mPaths)
+                writeValue(path, value);
+            mEditSession->mChanged = true;
+            mModel->notifyChanged();
+        }
+
+
+        bool Controller::isEditing(const std::vector<ValuePath>& paths) const
+        {
+            return mEditSession != nullptr && mEditSession->mPaths == paths;
+        }
+
+
+        void Controller::commitEdit()
+        {
+            if (mEditSession == nullptr)
+                return;
+
+            auto session = std::move(mEditSession);
+            if (!session->mChanged)
+                return;
+
+            // Recorded as one command sharing the paths between undo and redo, the values are kept in the spill store
+            auto paths = std::make_shared<std::vector<ValuePath>>(std::move(session->mPaths));
+            auto oldValues = spillValues(session->mOldValues);
+            auto overridden = std::move(session->mOverridden);
+            std::vector<rtti::Variant> values;
+            values.reserve(paths->size());
+            for (auto& path : *paths)
+                values.emplace_back(path.getValue());
+            auto newValues = spillValues(values);
+            addUndoStack(
+                [this, paths, newValues]()
+                {
+                    std::vector<rtti::Variant> values;
+                    if (!loadValues(newValues, *paths, values))
+                        return;
+                    for (auto i = 0; i < paths->size(); ++i)
+                    {
+                        (*paths)[i].resolve(*mModel);
+                        writeValue((*paths)[i], values[i]);
+                    }
+                },
+                [this, paths, oldValues, overridden]()
+                {
+                    std::vector<rtti::Variant> values;
+                    if (!loadValues(oldValues, *paths, values))
+                        return;
+                    for (auto i = 0; i < paths->size(); ++i)
+                    {
+                        (*paths)[i].resolve(*mModel);
+                        restoreValue((*paths)[i], values[i], overridden[i]);
+                    }
+                }
+            );
+        }
+
+
+        void Controller::setValues(std::vector<ValuePath> paths, const std::vector<rtti::Variant>& values)
+        {
+            assert(paths.size() == values.size());
+            commitEdit();
+            mModel->deferNotifications();
+
+            // Override states are gathered before writing, paths can share a root property
+            std::vector<bool> overridden;
+            overridden.reserve(paths.size());
+            for (auto& path : paths)
+            {
+                path.resolve(*mModel);
+                overridden.emplace_back(isOverridden(path));
+            }
+
+            std::vector<rtti::Variant> oldValues;
+            oldValues.reserve(paths.size());
+            for (auto i = 0; i < paths.size(); ++i)
+            {
+                oldValues.emplace_back(paths[i].getValue());
+                writeValue(paths[i], values[i]);
+            }
+
+            // Recorded as one command sharing the paths between undo and redo, like an edit of multiple resources
+            auto sharedPaths = std::make_shared<std::vector<ValuePath>>(std::move(paths));
+            auto spilledOldValues = spillValues(oldValues);
+            auto spilledValues = spillValues(values);
+            addUndoStack(
+                [this, sharedPaths, spilledValues]()
+                {
+                    std::vector<rtti::Variant> values;
+                    if (!loadValues(spilledValues, *sharedPaths, values))
+                        return;
+                    for (auto i = 0; i < sharedPaths->size(); ++i)
+                    {
+                        (*sharedPaths)[i].resolve(*mModel);
+                        writeValue((*sharedPaths)[i], values[i]);
+                    }
+                },
+                [this, sharedPaths, spilledOldValues, overridden]()
+                {
+                    std::vector<rtti::Variant> values;
+                    if (!loadValues(spilledOldValues, *sharedPaths, values))
+                        return;
+                    for (auto i = int(sharedPaths->size()) - 1; i >= 0; --i)
+                    {
+                        (*sharedPaths)[i].resolve(*mModel);
+                        restoreValue((*sharedPaths)[i], values[i], overridden[i]);
+                    }
+                }
+            );
+
+            mModel->resumeNotifications();
+        }
+
+
+        void Controller::beginTransaction()
+        {
+            commitEdit();
+            mTransactions.emplace_back();
+            mModel->deferNotifications();
+        }
+
+
+        void Controller::commitTransaction()
+        {
+            assert(isInTransaction());
+            commitEdit();
+            auto commands = std::make_shared<CommandList>(std::move(mTransactions.back()));
+            mTransactions.pop_back();
+
+            if (commands->size() == 1)
+                pushCommand(std::move(commands->front()));
+            else if (!commands->empty())
+            {
+                // Record all commands as one compound command, in the parent transaction if there is one
+                auto command = std::make_unique<Command>();
+                command->mRedo = [commands]()
+                {
+                    for (auto& child : *commands)
+                        child->mRedo();
+                };
+                command->mUndo = [commands]()
+                {
+                    for (auto it = commands->rbegin(); it != commands->rend(); ++it)
+                        (*it)->mUndo();
+                };
+                pushCommand(std::move(command));
+            }
+
+            mModel->resumeNotifications();
+        }
+
+
+        void Controller::abortTransaction()
+        {
+            assert(isInTransaction());
+            commitEdit();
+
+            // Roll back in reverse order
+            auto& commands = mTransactions.back();
+            for (auto it = commands.rbegin(); it != commands.rend(); ++it)
+                (*it)->mUndo();
+            mTransactions.pop_back();
+
+            mModel->notifyChanged();
+            mModel->resumeNotifications();
         }
 
 
         void Controller::undo()
         {
-            if (!mUndoStack.empty())
+            assert(!isInTransaction());
+            commitEdit();
+            if (canUndo())
             {
-                mUndoStack.back()->mUndo();
-                mRedoStack.emplace_back(std::move(mUndoStack.back()));
-                mUndoStack.pop_back();
+                undoState();
+                mModel->notifyChanged();
             }
         }
 
 
         void Controller::redo()
         {
-            if (!mRedoStack.empty())
+            assert(!isInTransaction());
+            commitEdit();
+            if (canRedo())
+            {
+                redoState(mHistory[mCurrentState].mRedoChild);
+                mModel->notifyChanged();
+            }
+        }
+
+
+        void Controller::jumpToState(int state)
+        {
+            assert(!isInTransaction());
+            assert(state >= 0 && state < mHistory.size());
+            commitEdit();
+            if (state == mCurrentState)
+                return;
+
+            // Find the common ancestor, collecting the states to redo on the way up from the target
+            std::vector<int> redoPath;
+            int ancestor = mCurrentState;
+            int target = state;
+            while (mHistory[target].mDepth > mHistory[ancestor].mDepth)
+            {
+                redoPath.emplace_back(target);
+                target = mHistory[target].mParent;
+            }
+            while (mHistory[ancestor].mDepth > mHistory[target].mDepth)
+                ancestor = mHistory[ancestor].mParent;
+            while (ancestor != target)
+            {
+                redoPath.emplace_back(target);
+                target = mHistory[target].mParent;
+                ancestor = mHistory[ancestor].mParent;
+            }
+
+            while (mCurrentState != ancestor)
+                undoState();
+            for (auto it = redoPath.rbegin(); it != redoPath.rend(); ++it)
+                redoState(*it);
+
+            mModel->notifyChanged();
+        }
+
+
+        void Controller::undoState()
+        {
+            auto& node = mHistory[mCurrentState];
+            node.mCommand->mUndo();
+            mHistory[node.mParent].mRedoChild = mCurrentState;
+            mCurrentState = node.mParent;
+        }
+
+
+        void Controller::redoState(int child)
+        {
+            auto& node = mHistory[child];
+            assert(node.mParent == mCurrentState);
+            node.mCommand->mRedo();
+            mHistory[mCurrentState].mRedoChild = child;
+            mCurrentState = child;
+        }
+
+
+        void Controller::processQueue()
+        {
+            auto start = std::chrono::steady_clock::now();
+            CommandQueue::Command command;
+            while (mQueue.pop(command))
             {
-                mRedoStack.back()->mRedo();
-                mUndoStack.emplace_back(std::move(mRedoStack.back()));
-                mRedoStack.pop_back();
+                command(*this);
+                auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+                if (elapsed >= mQueueTimeBudget)
+                    break;
             }
         }
 
 
+        bool Controller::writeValue(ValuePath& path, const rtti::Variant& value)
+        {
+            if (!path.setValue(value))
+                return false;
+            propertyChanged(path);
+            return true;
+        }
+
+
+        void Controller::propertyChanged(const ValuePath& path)
+        {
+            mModel->propertyChanged(path.getRootID(), path.getRootProperty());
+        }
+
+
+        Controller::SpilledValues Controller::spillValues(const std::vector<rtti::Variant>& values)
+        {
+            SpilledValues spilled;
+
+            // Numbers and enums, like the values of a drag, are too small to be worth encoding
+            bool scalar = std::all_of(values.begin(), values.end(), [](const rtti::Variant& value)
+            {
+                auto type = value.get_type();
+                return type.is_arithmetic() || type.is_enumeration();
+            });
+            if (scalar)
+            {
+                spilled.mValues = values;
+                return spilled;
+            }
+
+            std::vector<uint8_t> data;
+            for (auto& value : values)
+            {
+                if (!writeValue(value, data))
+                {
+                    spilled.mValues = values;
+                    return spilled;
+                }
+            }
+            if (data.size() < minimumSpillSize)
+            {
+                spilled.mValues = values;
+                return spilled;
+            }
+            spilled.mBlock = mSpillStore.store(std::move(data));
+            return spilled;
+        }
+
+
+        bool Controller::loadValues(const SpilledValues& spilled, std::vector<rtti::Variant>& values)
+        {
+            if (spilled.mBlock == nullptr)
+            {
+                values = spilled.mValues;
+                return true;
+            }
+
+            utility::ErrorState errorState;
+            auto data = mSpillStore.load(*spilled.mBlock, errorState);
+            if (data == nullptr)
+            {
+                Logger::error(errorState.toString().c_str());
+                return false;
+            }
+            auto position = data->data();
+            auto end = position + data->size();
+            auto resolve = [this](const std::string& mID) -> rtti::Object* { return mModel->findResource(mID); };
+            for (auto& value : values)
+            {
+                if (!readValue(position, end, value, resolve))
+                {
+                    Logger::error("Failed to read undo data");
+                    return false;
+                }
+            }
+            return true;
+        }
+
+
+        bool Controller::loadValues(const SpilledValues& spilled, std::vector<ValuePath>& paths, std::vector<rtti::Variant>& values)
+        {
+            values.clear();
+            values.reserve(paths.size());
+            for (auto& path : paths)
+            {
+                path.resolve(*mModel);
+                values.emplace_back(path.getValue());
+            }
+            return loadValues(spilled, values);
+        }
+
+
+        bool Controller::isOverridden(const ValuePath& path) const
+        {
+            auto derivation = mModel->getDerivation(path.getRootID());
+            return derivation == nullptr || derivation->mOverrides.find(path.getRootProperty()) != derivation->mOverrides.end();
+        }
+
+
+        void Controller::restoreValue(ValuePath& path, const rtti::Variant& value, bool overridden)
+        {
+            if (writeValue(path, value))
+                restoreOverride(path, overridden);
+        }
+
+
+        void Controller::restoreOverride(const ValuePath& path, bool overridden)
+        {
+            // Changing the property marks it as overridden, revert it so that the resource follows its template again
+            if (overridden)
+                return;
+            auto derivation = mModel->getDerivation(path.getRootID());
+            if (derivation != nullptr && derivation->mOverrides.find(path.getRootProperty()) != derivation->mOverrides.end())
+                mModel->revertOverride(path.getRootID(), path.getRootProperty());
+        }
+
+
         void Controller::addUndoStack(std::function<void()> doFunction, std::function<void()> undoFunction)
         {
             auto command = std::make_unique<Command>();
             command->mUndo = std::move(undoFunction);
             command->mRedo = std::move(doFunction);
-            mUndoStack.emplace_back(std::move(command));
-            mRedoStack.clear();
+            pushCommand(std::move(command));
+        }
+
+
+        void Controller::pushCommand(std::unique_ptr<Command> command)
+        {
+            if (isInTransaction())
+            {
+                mTransactions.back().emplace_back(std::move(command));
+                mModel->notifyChanged();
+                return;
+            }
+
+            // Start a new branch from the current state, existing branches are kept
+            int state = mHistory.size();
+            mHistory.emplace_back();
+            auto& node = mHistory.back();
+            node.mParent = mCurrentState;
+            node.mDepth = mHistory[mCurrentState].mDepth + 1;
+            node.mCommand = std::move(command);
+            mHistory[mCurrentState].mChildren.emplace_back(state);
+            mHistory[mCurrentState].mRedoChild = state;
+            mCurrentState = state;
+            mModel->notifyChanged();
         }
 
 
@@ -373,6 +1318,7 @@ namespace nap
             assert(path.isArray());
             assert(path.isResolved());
 
+            bool overridden = isOverridden(path);
             doInsertArrayElement(path, element);
             auto mID = element->mID;
             addUndoStack(
@@ -383,38 +1329,17 @@ namespace nap
                     if (element != nullptr)
                         doInsertArrayElement(path, element);
                 },
-                [this, path]() mutable
+                [this, path, overridden]() mutable
                 {
                     path.resolve(*mModel);
                     if (path.isResolved())
                         doRemoveArrayElement(path);
+                    restoreOverride(path, overridden);
                 }
             );
         }
 
 
-        Controller::ValuePath::ValuePath(const ValuePath &other) : mResolvedPath()
-        {
-            mRootID = other.mRootID;
-            mPath = other.mPath;
-            mResolvedPath = other.mResolvedPath;
-            mIsArrayElement = other.mIsArrayElement;
-            mArrayIndex = other.mArrayIndex;
-            mIsResolved = false;
-        }
-
-
-        Controller::ValuePath::ValuePath(ValuePath &&other) : mResolvedPath()
-        {
-            mRootID = other.mRootID;
-            mPath = other.mPath;
-            mResolvedPath = other.mResolvedPath;
-            mIsArrayElement = other.mIsArrayElement;
-            mArrayIndex = other.mArrayIndex;
-            mIsResolved = false;
-        }
-
-
         void Controller::ValuePath::set(const rtti::Path &path, Resource *root)
         {
             mRootID = root->mID;
@@ -447,8 +1372,53 @@ namespace nap
         }
 
 
+        std::string Controller::ValuePath::getRootProperty() const
+        {
+            auto path = mPath.toString();
+            return path.substr(0, path.find('/'));
+        }
+
+
+        rtti::Variant Controller::ValuePath::getValue()
+        {
+            if (!mIsArrayElement)
+                return mResolvedPath.getValue();
+            auto array = mResolvedPath.getValue();
+            auto view = array.create_array_view();
+            assert(mArrayIndex >= 0 && mArrayIndex < view.get_size());
+            return view.get_value(mArrayIndex);
+        }
+
+
+        bool Controller::ValuePath::setValue(const rtti::Variant &value)
+        {
+            if (!mIsArrayElement)
+                return mResolvedPath.setValue(value);
+            auto array = mResolvedPath.getValue();
+            auto view = array.create_array_view();
+            if (mArrayIndex < 0 || mArrayIndex >= view.get_size())
+                return false;
+            if (!view.set_value(mArrayIndex, value))
+                return false;
+            return mResolvedPath.setValue(array);
+        }
+
+
+        bool Controller::ValuePath::operator==(const ValuePath &other) const
+        {
+            if (mRootID != other.mRootID || mIsArrayElement != other.mIsArrayElement)
+                return false;
+            if (mIsArrayElement && mArrayIndex != other.mArrayIndex)
+                return false;
+            return mPath == other.mPath;
+        }
+
+
         void Controller::ValuePath::resolve(Resource* root)
         {
+            mRoot = root;
+            mRootType = root->get_type();
+            mGeneration = 0;
             mIsResolved = mPath.resolve(root, mResolvedPath);
             if (mIsArrayElement)
             {
@@ -461,9 +1431,22 @@ namespace nap
 
         void Controller::ValuePath::resolve(Model& model)
         {
+            // No resources were added, removed or renamed since the root was validated
+            if (mIsResolved && mGeneration == model.getStructureGeneration())
+                return;
+
             auto root = model.findResource(mRootID);
             assert(root != nullptr);
+
+            // The resolved path is still bound to the same object, only restamp it
+            if (mIsResolved && root == mRoot && root->get_type() == mRootType)
+            {
+                mGeneration = model.getStructureGeneration();
+                return;
+            }
+
             resolve(root);
+            mGeneration = model.getStructureGeneration();
         }
 
     }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <model.h>
+#include <spillstore.h>
+#include <commandqueue.h>
 
 namespace nap
 {
@@ -16,12 +18,21 @@ namespace nap
 			{
 			public:
 				ValuePath() : mResolvedPath() { };
-				ValuePath(const ValuePath&);
-				ValuePath(ValuePath&&);
+				ValuePath(const ValuePath&) = default;
+				ValuePath(ValuePath&&) = default;
+				ValuePath& operator=(const ValuePath&) = default;
+				ValuePath& operator=(ValuePath&&) = default;
 				void set(const rtti::Path& path, Resource* root);
 				void set(const rtti::Path& arrayPath, int index, Resource* root);
 				void set(int arrayIndex);
 				void clear() { mIsResolved = false; }
+
+				/**
+				 * Resolves the path against the model. The resolved path is bound to the root resource and cached:
+				 * as long as the root resource is still the same object no rtti lookups are performed, and as long as
+				 * the structure generation of the model is unchanged not even the root resource is looked up.
+				 * @param model The model containing the root resource.
+				 */
 				void resolve(Model& model);
 				bool isResolved() const { return mIsResolved; }
 				bool isArrayElement() const { return mIsArrayElement; }
@@ -30,13 +41,36 @@ namespace nap
 				bool isPointer() const { return mResolvedPath.getType().is_derived_from<rtti::ObjectPtrBase>(); }
 				rtti::ResolvedPath& getResolvedPath() { return mResolvedPath; }
 				const rtti::Path& getPath() const;
+				const std::string& getRootID() const { return mRootID; }
+
+				/**
+				 * @return Name of the property of the root resource the path starts with.
+				 */
+				std::string getRootProperty() const;
+
+				/**
+				 * @return The value the path points to. For array element paths only the element is returned.
+				 */
+				rtti::Variant getValue();
+
+				/**
+				 * Sets the value the path points to. For array element paths only the element is replaced.
+				 * @param value The new value.
+				 * @return True on success.
+				 */
+				bool setValue(const rtti::Variant& value);
+				bool operator==(const ValuePath& other) const;
+				bool operator!=(const ValuePath& other) const { return !(*this == other); }
 
 			private:
 				void resolve(Resource* root);
 
 				std::string mRootID;
 				rtti::Path mPath;
-				rtti::ResolvedPath mResolvedPath;
+				rtti::ResolvedPath mResolvedPath;	// Property handles and indices bound to mRoot
+				Resource* mRoot = nullptr;			// Resource the resolved path is bound to
+				rtti::TypeInfo mRootType = rtti::TypeInfo::get<void>();	// Type of mRoot, guards against a new resource reusing the address of a removed one
+				uint64_t mGeneration = 0;			// Structure generation of the model when mRoot was last validated
 				bool mIsArrayElement = false;
 				int mArrayIndex = -1;
 				bool mIsResolved = false;
@@ -45,14 +79,77 @@ namespace nap
 		public:
 			Controller() = default;
 
-			ResourcePtr<Model> mModel;
+			ResourcePtr<Model> mModel;							///< Property: 'Model' The model that is edited
+			int mUndoMemoryBudget = 64;							///< Property: 'UndoMemoryBudget' Megabytes of undo data kept in memory, older undo data is spilled to disk
+			std::string mUndoSpillPath;							///< Property: 'UndoSpillPath' Path of the file older undo data is spilled to, empty for a file in the temporary directory named after the process
+			float mQueueTimeBudget = 4.f;						///< Property: 'QueueTimeBudget' Milliseconds per frame spent executing queued commands
+
+			bool init(utility::ErrorState& errorState) override;
+
 			bool renameResource(const std::string& oldID, const std::string& newID);
 			void createGroup(const rtti::TypeInfo& type);
 			void createEntity();
 			void createChildGroup(const std::string& parentID);
 			void removeResource(const std::string& mID);
+
+			/**
+			 * Removes multiple resources as one undo step, with a single pass over the tree.
+			 * Resources embedded in other removed resources are removed together with the resource that embeds them.
+			 * @param mIDs Ids of the resources to remove.
+			 */
+			void removeResources(const std::vector<std::string>& mIDs);
+
+			/**
+			 * Deep copies resources, including their embedded objects, group members and children and entity children, as one undo step.
+			 * Pointers between copied objects point to the copies, pointers to other objects are kept.
+			 * @param mIDs Ids of the resources to copy.
+			 * @return Ids of the copies of the given resources.
+			 */
+			std::vector<std::string> duplicate(const std::vector<std::string>& mIDs);
+
+			/**
+			 * Moves resources and groups to a group as one undo step, with a single pass over the tree.
+			 * @param mIDs Ids of the resources to move. Resources that are not in the tree, entities and components are ignored.
+			 * @param groupID ID of the target group, empty to move to the root of the tree.
+			 */
+			void moveResources(const std::vector<std::string>& mIDs, const std::string& groupID);
 			void createResource(const rtti::TypeInfo& type, const std::string& parentID);
+
+			/**
+			 * Creates a number of resources at once, recorded as one undo step.
+			 * @param type Type of the new resources.
+			 * @param count Number of resources to create.
+			 * @param pattern Naming pattern, the first '#' is replaced by a number. When empty the type name is used.
+			 * @param parentID ID of the group or entity to add the resources to, empty for the root of the tree. Components require an entity.
+			 * @param templateID ID of a resource of the same type to copy property values from, empty to use default values.
+			 * Embedded objects of the template are not copied.
+			 * @return The ids of the new resources.
+			 */
+			std::vector<std::string> createResources(const rtti::TypeInfo& type, int count, const std::string& pattern, const std::string& parentID, const std::string& templateID = "");
 			void createGroup(const rtti::TypeInfo& type, const std::string& parentID);
+
+			/**
+			 * Derives a resource from a template resource of the same type, or detaches it from its template.
+			 * Properties with the same value as in the template follow the template from now on, the other properties become overrides.
+			 * @param mID Id of the resource to derive.
+			 * @param templateID Id of the template, empty to detach the resource from its template.
+			 * @return False if the resource cannot be derived from the template.
+			 */
+			bool setTemplate(const std::string& mID, const std::string& templateID);
+
+			/**
+			 * Creates a new resource derived from a template, next to the template in the tree.
+			 * @param templateID Id of the template resource.
+			 * @return Id of the new resource.
+			 */
+			std::string createDerived(const std::string& templateID);
+
+			/**
+			 * Removes an override from a derived resource, the property gets the value of the template again.
+			 * @param mID Id of the derived resource.
+			 * @param propertyName Name of the overridden property.
+			 */
+			void revertOverride(const std::string& mID, const std::string& propertyName);
 			void addChildEntity(const std::string& childID, const std::string& parentID);
 			void createComponent(const rtti::TypeInfo& type, const std::string& entityID);
 			void createEmbeddedObject(ValuePath& path, const rtti::TypeInfo& type);
@@ -69,24 +166,268 @@ namespace nap
 			void moveArrayElementUp(ValuePath& path);
 			void moveArrayElementDown(ValuePath& path);
 
+			/**
+			 * Removes the elements in the range [first, last) from the array at path in a single pass.
+			 * @param path Path to the array or to one of its elements.
+			 * @param first Index of the first element to remove.
+			 * @param last Index one past the last element to remove.
+			 */
+			void removeArrayElements(ValuePath& path, int first, int last);
+
+			/**
+			 * Inserts count default constructed elements in the array at path in a single pass.
+			 * @param path Path to the array or to one of its elements.
+			 * @param index Index at which the first new element is inserted.
+			 * @param count Number of elements to insert.
+			 */
+			void insertArrayElements(ValuePath& path, int index, int count);
+
+			/**
+			 * Moves the block of elements [first, last) within the array at path, so that the block starts at target afterwards.
+			 * Only the elements between the old and new position of the block are written.
+			 * @param path Path to the array or to one of its elements.
+			 * @param first Index of the first element of the block.
+			 * @param last Index one past the last element of the block.
+			 * @param target Index of the first element of the block after the move.
+			 */
+			void moveArrayElements(ValuePath& path, int first, int last, int target);
+
+			/**
+			 * Sorts the array at path in ascending order. The sort is stable.
+			 * Does nothing when the key, or the elements when sorting by value, can not be sorted, see isSortKey().
+			 * @param path Path to the array or to one of its elements.
+			 * @param key Name of the property of the elements to sort by, empty to sort by the value of the elements.
+			 */
+			void sortArray(ValuePath& path, const std::string& key = "");
+
+			/**
+			 * @return Whether values of the type can be compared to sort an array: arithmetic types, enums and strings.
+			 */
+			static bool isSortKey(const rtti::TypeInfo& type);
+
+			/**
+			 * Starts an edit session on the value at path, used for continuous edits like dragging a slider.
+			 * Intermediate values are applied directly, the session is recorded as one undo step when it is committed.
+			 * An edit session that is already running on a different path is committed first.
+			 * @param path Path to the edited value.
+			 */
+			void beginEdit(const ValuePath& path);
+
+			/**
+			 * Starts an edit session on the same value in multiple resources, used to edit a property of all selected resources at once.
+			 * The session is recorded as one undo step for all paths when it is committed.
+			 * @param paths Paths to the edited value in each resource.
+			 */
+			void beginEdit(const std::vector<ValuePath>& paths);
+
+			/**
+			 * Applies an intermediate value to the edit session on path, without adding an undo step.
+			 * Starts a new edit session when no session is running on path.
+			 * @param path Path to the edited value.
+			 * @param value The new value.
+			 */
+			void updateEdit(const ValuePath& path, const rtti::Variant& value);
+
+			/**
+			 * Applies an intermediate value to all paths of the edit session, without adding an undo step.
+			 * Starts a new edit session when no session is running on exactly these paths.
+			 * @param paths Paths to the edited value in each resource.
+			 * @param value The new value.
+			 */
+			void updateEdit(const std::vector<ValuePath>& paths, const rtti::Variant& value);
+
+			/**
+			 * Ends the running edit session and adds a single undo step from the value before the session to the final value.
+			 * Does nothing when no session is running.
+			 */
+			void commitEdit();
+
+			/**
+			 * @return True when an edit session is running.
+			 */
+			bool isEditing() const { return mEditSession != nullptr; }
+
+			/**
+			 * @return True when an edit session is running on path.
+			 */
+			bool isEditing(const ValuePath& path) const { return mEditSession != nullptr && mEditSession->mPaths.size() == 1 && mEditSession->mPaths.front() == path; }
+
+			/**
+			 * @return True when an edit session is running on exactly these paths.
+			 */
+			bool isEditing(const std::vector<ValuePath>& paths) const;
+
+			/**
+			 * Sets a different value at each path, recorded as one undo step. Used to apply many edits at once, like a find and replace.
+			 * Change notifications of the model are deferred until all values are set.
+			 * @param paths Paths to the values to set.
+			 * @param values New value for each path.
+			 */
+			void setValues(std::vector<ValuePath> paths, const std::vector<rtti::Variant>& values);
+
+			/**
+			 * Starts a transaction. All commands executed until the transaction is committed are recorded as a single undo step.
+			 * Change notifications of the model are deferred until the outermost transaction ends.
+			 * Transactions can be nested, a nested transaction becomes a single command within its parent.
+			 */
+			void beginTransaction();
+
+			/**
+			 * Ends the current transaction and records its commands as one compound command.
+			 */
+			void commitTransaction();
+
+			/**
+			 * Ends the current transaction and rolls back all commands executed within it.
+			 */
+			void abortTransaction();
+
+			/**
+			 * @return True while a transaction is running.
+			 */
+			bool isInTransaction() const { return !mTransactions.empty(); }
+
 			void undo();
 			void redo();
 
+			/**
+			 * Queues a command to be executed on the thread that owns the Controller. Can be called from any thread.
+			 * The command is called with this Controller during processQueue() and can use the whole Controller API,
+			 * every call it makes is recorded for undo exactly as if it was made directly.
+			 * Wrap the calls in a transaction to record them as a single undo step.
+			 * @param command The command to execute.
+			 */
+			void post(CommandQueue::Command command) { mQueue.push(std::move(command)); }
+
+			/**
+			 * Executes queued commands in the order they were posted, until the queue is empty or QueueTimeBudget is spent.
+			 * At least one command is executed per call. Call once per frame from the thread that owns the Controller.
+			 */
+			void processQueue();
+
+			/**
+			 * The undo history is a tree of states. Every command leads from a state to a new child state, undoing
+			 * and then editing starts a new branch instead of discarding the redo history.
+			 * State 0 is the root: the model before the first recorded command.
+			 * @return The state the model is currently in.
+			 */
+			int getCurrentState() const { return mCurrentState; }
+
+			/**
+			 * @return Number of states in the undo history, states are numbered 0 to getStateCount() - 1 in the order they were created.
+			 */
+			int getStateCount() const { return mHistory.size(); }
+
+			/**
+			 * @return The state that state was created from, -1 for the root state.
+			 */
+			int getParentState(int state) const { return mHistory[state].mParent; }
+
+			/**
+			 * @return All states created from state, one for each branch, oldest first.
+			 */
+			const std::vector<int>& getChildStates(int state) const { return mHistory[state].mChildren; }
+
+			/**
+			 * @return Number of commands between the root state and state.
+			 */
+			int getStateDepth(int state) const { return mHistory[state].mDepth; }
+
+			/**
+			 * Brings the model to any state in the undo history.
+			 * Only the commands on the path between the current state and the target are undone and redone.
+			 * @param state The target state.
+			 */
+			void jumpToState(int state);
+
+			/**
+			 * @return True if there is a state to undo to.
+			 */
+			bool canUndo() const { return mCurrentState != 0; }
+
+			/**
+			 * @return True if there is a state to redo to, following the most recently visited branch.
+			 */
+			bool canRedo() const { return mHistory[mCurrentState].mRedoChild >= 0; }
+
 		private:
+			/**
+			 * Fetches the array at path once, lets modify() change it in place through an array view and writes it back once.
+			 */
+			template <typename F>
+			void modifyArray(ValuePath& path, F modify);
+
 			template <typename T>
 			void doInsertArrayElement(ValuePath& path, T element);
+			void doInsertArrayElements(ValuePath& path, int index, const std::vector<rtti::Variant>& elements);
+			std::vector<rtti::Variant> doRemoveArrayElements(ValuePath& path, int first, int last);
+			void doMoveArrayElements(ValuePath& path, int first, int last, int target);
+			void doPermuteArray(ValuePath& path, const std::vector<int>& order);
 			void doRemoveArrayElement(ValuePath& path);
 			bool doMoveArrayElementUp(ValuePath& path);
 			bool doMoveArrayElementDown(ValuePath& path);
 
+			// Sets the value at path and notifies the model, which updates the tree and the resources derived from the root resource
+			bool writeValue(ValuePath& path, const rtti::Variant& value);
+			void propertyChanged(const ValuePath& path);
+
+			// Whether the root property of path is overridden, true when the root resource is not derived from a template
+			bool isOverridden(const ValuePath& path) const;
+
+			// Undoes a write: restores value and reverts the override when the property was not overridden before the write
+			void restoreValue(ValuePath& path, const rtti::Variant& value, bool overridden);
+			// Reverts the override of the root property of path when it was not overridden before the undone command
+			void restoreOverride(const ValuePath& path, bool overridden);
+
+			// Values kept by a command, spilled to the SpillStore in binary form. Small values and values without a binary form stay in memory.
+			struct SpilledValues
+			{
+				SpillStore::BlockPtr mBlock;
+				std::vector<rtti::Variant> mValues;
+			};
+			SpilledValues spillValues(const std::vector<rtti::Variant>& values);
+			// Loads spilled values into values, which holds a value of the spilled type at every index on input
+			bool loadValues(const SpilledValues& spilled, std::vector<rtti::Variant>& values);
+			// Loads spilled values into the current values of paths, which are resolved first
+			bool loadValues(const SpilledValues& spilled, std::vector<ValuePath>& paths, std::vector<rtti::Variant>& values);
+
 			void addUndoStack(std::function<void()> doFunction, std::function<void()> undoFunction);
 			struct Command
 			{
 				std::function<void()> mUndo;
 				std::function<void()> mRedo;
 			};
-			std::vector<std::unique_ptr<Command>> mUndoStack;
-			std::vector<std::unique_ptr<Command>> mRedoStack;
+			using CommandList = std::vector<std::unique_ptr<Command>>;
+			void pushCommand(std::unique_ptr<Command> command);
+
+			// A state in the undo history. Branches share the states they have in common, every command is stored exactly once.
+			struct HistoryNode
+			{
+				int mParent = -1;					// State this state was created from
+				int mDepth = 0;						// Number of commands between the root and this state
+				int mRedoChild = -1;				// Child state redo leads to, the most recently visited branch
+				std::vector<int> mChildren;			// States created from this state
+				std::unique_ptr<Command> mCommand;	// Command leading from the parent to this state, null for the root
+			};
+			void undoState();
+			void redoState(int child);
+
+			SpillStore mSpillStore;		// Bulk undo data, declared before the history so that it outlives the commands referencing it
+			std::vector<HistoryNode> mHistory = std::vector<HistoryNode>(1);
+			int mCurrentState = 0;
+			CommandQueue mQueue;		// Commands posted from other threads
+			std::vector<CommandList> mTransactions; // Commands recorded by the running (nested) transactions
+
+			struct EditSession
+			{
+				EditSession(const std::vector<ValuePath>& paths) : mPaths(paths) { }
+				std::vector<ValuePath> mPaths;
+				std::vector<rtti::Variant> mOldValues;	// Value of each path before the session
+				std::vector<bool> mOverridden;			// Override state of each path before the session
+				bool mChanged = false;
+			};
+			void applyEdit(const rtti::Variant& value);
+			std::unique_ptr<EditSession> mEditSession;
 		};
 
 
@@ -94,18 +435,20 @@ namespace nap
 		void Controller::setValue(ValuePath &path, const T &value)
 		{
 			assert(path.isResolved());
-			auto oldValue = path.getResolvedPath().getValue();
-			path.getResolvedPath().setValue(value);
+			// For array element paths only the element is recorded, not the whole array
+			auto oldValue = path.getValue();
+			auto overridden = isOverridden(path);
+			writeValue(path, value);
 			addUndoStack(
 				[this, path, value]() mutable
 				{
 					path.resolve(*mModel);
-					path.getResolvedPath().setValue(value);
+					writeValue(path, value);
 				},
-				[this, path, oldValue]() mutable
+				[this, path, oldValue, overridden]() mutable
 				{
 					path.resolve(*mModel);
-					path.getResolvedPath().setValue(oldValue);
+					restoreValue(path, oldValue, overridden);
 				}
 			);
 		}
@@ -117,6 +460,7 @@ namespace nap
 			assert(path.isArray());
 			assert(path.isResolved());
 
+			bool overridden = isOverridden(path);
 			doInsertArrayElement(path, element);
 			addUndoStack(
 				[this, path, element]() mutable
@@ -124,28 +468,40 @@ namespace nap
 					path.resolve(*mModel);
 					doInsertArrayElement(path, element);
 				},
-				[this, path]() mutable
+				[this, path, overridden]() mutable
 				{
 					path.resolve(*mModel);
 					doRemoveArrayElement(path);
+					restoreOverride(path, overridden);
 				}
 			);
 		}
 
 
-		template <typename T>
-		void Controller::doInsertArrayElement(ValuePath& path, T element)
+		template <typename F>
+		void Controller::modifyArray(ValuePath& path, F modify)
 		{
 			auto array = path.getResolvedPath().getValue();
 			auto view = array.create_array_view();
-			if (path.isArrayElement())
-			{
-				assert(path.getArrayIndex() <= view.get_size());
-				view.insert_value(path.getArrayIndex(), element);
-			}
-			else if (path.isArray())
-				view.insert_value(view.get_size(), element);
+			modify(view);
 			path.getResolvedPath().setValue(array);
+			propertyChanged(path);
+		}
+
+
+		template <typename T>
+		void Controller::doInsertArrayElement(ValuePath& path, T element)
+		{
+			modifyArray(path, [&](auto& view)
+			{
+				if (path.isArrayElement())
+				{
+					assert(path.getArrayIndex() <= view.get_size());
+					view.insert_value(path.getArrayIndex(), element);
+				}
+				else if (path.isArray())
+					view.insert_value(view.get_size(), element);
+			});
 		}
 
 
@@ -1,5 +1,7 @@
 #include "filteredmenu.h"
 
+#include <algorithm>
+#include <cctype>
 
 namespace nap
 {
@@ -7,35 +9,249 @@ namespace nap
     namespace edit
     {
 
+        namespace
+        {
+            // Scores of the fuzzy match
+            constexpr int characterScore = 16;
+            constexpr int boundaryBonus = 8;
+            constexpr int adjacentBonus = 4;
+            constexpr int gapPenalty = 3;
+            constexpr int gapExtensionPenalty = 1;
+            constexpr int maxGapPenalty = 12;
+
+            bool isSeparator(char c)
+            {
+                return c == ':' || c == '/' || c == '.' || c == '_' || c == '-' || c == ' ';
+            }
+
+            // Whether a character starts a word, like the 'G' in 'nap::GuiService' or in 'guiService'
+            bool isBoundary(const std::string& item, int position)
+            {
+                if (position == 0)
+                    return true;
+                unsigned char previous = item[position - 1];
+                unsigned char current = item[position];
+                return isSeparator(previous) ||
+                    (std::isupper(current) && std::islower(previous)) ||
+                    (std::isdigit(current) && !std::isdigit(previous));
+            }
+        }
+
+
         void FilteredMenu::init(const std::vector<std::string> &&items)
         {
             mItems = std::move(items);
+            mLowerCaseItems.resize(mItems.size());
+            mMasks.resize(mItems.size());
+            for (int i = 0; i < mItems.size(); ++i)
+            {
+                mLowerCaseItems[i] = mItems[i];
+                std::transform(mLowerCaseItems[i].begin(), mLowerCaseItems[i].end(), mLowerCaseItems[i].begin(), ::tolower);
+                mMasks[i] = getCharacterMask(mLowerCaseItems[i]);
+            }
+            mCandidates.resize(mItems.size());
+            mScores.resize(mItems.size());
             mFilteredItems.clear();
+            mAppliedFilter.clear();
 
             mSelectedItem.clear();
             mSelectedItemIndex = 0;
             mSearchFilter[0] = '\0';
+            mCursor = 0;
+            updateFilter();
 
             mFirstShow = true;
         }
 
 
-        struct FilterInputCallbackData
+        uint32_t FilteredMenu::getCharacterMask(const std::string& lowerCase)
+        {
+            uint32_t mask = 0;
+            for (char c : lowerCase)
+            {
+                if (c >= 'a' && c <= 'z')
+                    mask |= 1u << (c - 'a');
+                else if (c >= '0' && c <= '9')
+                    mask |= 1u << 26;
+                else if (c == ':')
+                    mask |= 1u << 27;
+                else if (c == '_')
+                    mask |= 1u << 28;
+                else if (c == '.')
+                    mask |= 1u << 29;
+                else if (c == ' ')
+                    mask |= 1u << 30;
+                else
+                    mask |= 1u << 31;
+            }
+            return mask;
+        }
+
+
+        bool FilteredMenu::match(int index, const std::string& filter, int& score, int* positions) const
+        {
+            const auto& item = mItems[index];
+            const auto& lowerCase = mLowerCaseItems[index];
+            int length = lowerCase.size();
+            int filterLength = filter.size();
+
+            // Find where the first match ends
+            int end = -1;
+            for (int i = 0, f = 0; i < length; ++i)
+            {
+                if (lowerCase[i] == filter[f] && ++f == filterLength)
+                {
+                    end = i;
+                    break;
+                }
+            }
+            if (end < 0)
+                return false;
+
+            // Walk back to find the shortest window that ends there
+            int start = end;
+            for (int i = end, f = filterLength - 1; i >= 0; --i)
+            {
+                if (lowerCase[i] == filter[f] && f-- == 0)
+                {
+                    start = i;
+                    break;
+                }
+            }
+
+            score = 0;
+            int previous = -1;
+            for (int i = start, f = 0; i <= end && f < filterLength; ++i)
+            {
+                if (lowerCase[i] != filter[f])
+                    continue;
+                score += characterScore;
+                if (isBoundary(item, i))
+                    score += boundaryBonus;
+                if (previous >= 0)
+                {
+                    int gap = i - previous - 1;
+                    if (gap == 0)
+                        score += adjacentBonus;
+                    else
+                        score -= std::min(gapPenalty + (gap - 1) * gapExtensionPenalty, maxGapPenalty);
+                }
+                if (positions != nullptr)
+                    positions[f] = i;
+                previous = i;
+                ++f;
+            }
+            return true;
+        }
+
+
+        void FilteredMenu::updateFilter()
+        {
+            std::string filter = mSearchFilter;
+            std::transform(filter.begin(), filter.end(), filter.begin(), ::tolower);
+            if (filter == mAppliedFilter)
+                return;
+
+            mCursor = 0;
+            mScrollToCursor = true;
+            if (filter.empty())
+            {
+                mFilteredItems.clear();
+                mAppliedFilter.clear();
+                return;
+            }
+
+            if (!mAppliedFilter.empty() && filter.compare(0, mAppliedFilter.size(), mAppliedFilter) == 0)
+            {
+                // Every item that matches the new filter also matches the old one, only the old matches have to be scored again
+                auto end = std::remove_if(mFilteredItems.begin(), mFilteredItems.end(), [&](int index){ return !match(index, filter, mScores[index], nullptr); });
+                mFilteredItems.erase(end, mFilteredItems.end());
+            }
+            else
+            {
+                // An item can only match when it contains every character of the filter.
+                // The mask test is branch free over contiguous arrays, so the compiler vectorizes it.
+                uint32_t filterMask = getCharacterMask(filter);
+                const uint32_t* masks = mMasks.data();
+                uint8_t* candidates = mCandidates.data();
+                int count = mMasks.size();
+                for (int i = 0; i < count; ++i)
+                    candidates[i] = (masks[i] & filterMask) == filterMask;
+
+                mFilteredItems.clear();
+                for (int i = 0; i < count; ++i)
+                    if (candidates[i] && match(i, filter, mScores[i], nullptr))
+                        mFilteredItems.emplace_back(i);
+            }
+
+            // Best score first, shorter items first when equal
+            std::sort(mFilteredItems.begin(), mFilteredItems.end(), [&](int a, int b)
+            {
+                if (mScores[a] != mScores[b])
+                    return mScores[a] > mScores[b];
+                if (mItems[a].size() != mItems[b].size())
+                    return mItems[a].size() < mItems[b].size();
+                return a < b;
+            });
+            mAppliedFilter = std::move(filter);
+        }
+
+
+        int FilteredMenu::getShownCount() const
         {
-            std::vector<std::string>* mItems = nullptr;
-            std::vector<std::string>* mFilteredItems = nullptr;
-            char* mSearchFilter;
-        };
+            return mAppliedFilter.empty() ? mItems.size() : mFilteredItems.size();
+        }
 
 
-        int FilterInputCallBack(ImGuiInputTextCallbackData* callbackData)
+        int FilteredMenu::getShownItem(int position) const
         {
-            FilterInputCallbackData* data = (FilterInputCallbackData*)callbackData->UserData;
-            data->mFilteredItems->clear();
-            for (auto& item : *data->mItems)
-                if (utility::contains(item, data->mSearchFilter, false))
-                    data->mFilteredItems->emplace_back(item);
-            return 0;
+            return mAppliedFilter.empty() ? position : mFilteredItems[position];
+        }
+
+
+        bool FilteredMenu::drawItem(int index, bool selected)
+        {
+            const auto& item = mItems[index];
+            ImGui::PushID(index);
+            bool clicked = ImGui::Selectable("##Item", selected);
+            ImGui::PopID();
+
+            // Draw the item in runs of matched and unmatched characters
+            int positions[sizeof(mSearchFilter)];
+            int score;
+            int matched = 0;
+            if (!mAppliedFilter.empty() && match(index, mAppliedFilter, score, positions))
+                matched = mAppliedFilter.size();
+
+            auto drawList = ImGui::GetWindowDrawList();
+            auto textColor = ImGui::GetColorU32(ImGuiCol_Text);
+            auto highlightColor = ImGui::GetColorU32(ImGuiCol_CheckMark);
+            auto position = ImGui::GetItemRectMin();
+            const char* text = item.c_str();
+            int start = 0;
+            int f = 0;
+            while (start < item.size())
+            {
+                bool highlighted = f < matched && positions[f] == start;
+                int end = start + 1;
+                if (highlighted)
+                {
+                    ++f;
+                    while (f < matched && positions[f] == end)
+                    {
+                        ++f;
+                        ++end;
+                    }
+                }
+                else
+                {
+                    end = f < matched ? positions[f] : item.size();
+                }
+                drawList->AddText(position, highlighted ? highlightColor : textColor, text + start, text + end);
+                position.x += ImGui::CalcTextSize(text + start, text + end).x;
+                start = end;
+            }
+            return clicked;
         }
 
 
@@ -44,45 +260,71 @@ namespace nap
             bool result = false;
 
             // Filter the available items using input text
-            FilterInputCallbackData data = { &mItems, &mFilteredItems, mSearchFilter };
+            // Filtering only runs on frames in which the text was edited
+            bool enter = ImGui::InputText("Filter", mSearchFilter, sizeof(mSearchFilter), ImGuiInputTextFlags_EnterReturnsTrue);
+            if (ImGui::IsItemEdited())
+                updateFilter();
+            int count = getShownCount();
 
-            if (ImGui::InputText("Filter", mSearchFilter, sizeof(mSearchFilter), ImGuiInputTextFlags_CallbackAlways | ImGuiInputTextFlags_EnterReturnsTrue, FilterInputCallBack, &data))
+            // Keyboard navigation through the results
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_DownArrow)) && mCursor < count - 1)
             {
-                if (mFilteredItems.size() == 1)
-                {
-                    mSelectedItemIndex = 0;
-                    mSelectedItem = *mFilteredItems.begin();
-                    ImGui::CloseCurrentPopup();
-                    result = true;
-                }
+                ++mCursor;
+                mScrollToCursor = true;
             }
+            if (ImGui::IsKeyPressed(ImGui::GetKeyIndex(ImGuiKey_UpArrow)) && mCursor > 0)
+            {
+                --mCursor;
+                mScrollToCursor = true;
+            }
+            if (enter && mCursor < count)
+            {
+                mSelectedItemIndex = getShownItem(mCursor);
+                mSelectedItem = mItems[mSelectedItemIndex];
+                ImGui::CloseCurrentPopup();
+                result = true;
+            }
+
             if (mFirstShow)
             {
                 ImGui::SetKeyboardFocusHere();
                 mFirstShow = false;
             }
 
-            // List with all available items filtered
-            auto& showedMap = mFilteredItems;
-            if (std::string(mSearchFilter).empty())
-                showedMap = mItems;
-
-            if (ImGui::ListBoxHeader("##FilteredItemsListBox", showedMap.size(), 20))
+            // List with all available items filtered, only the visible items are drawn
+            if (ImGui::ListBoxHeader("##FilteredItemsListBox", count, 20))
             {
-                auto item = showedMap.begin();
-                for (int i = 0; i < showedMap.size(); ++i)
+                // Keep the cursor in view
+                if (mScrollToCursor)
+                {
+                    float itemHeight = ImGui::GetTextLineHeightWithSpacing();
+                    float top = mCursor * itemHeight;
+                    float bottom = top + itemHeight;
+                    float height = ImGui::GetWindowHeight();
+                    if (top < ImGui::GetScrollY())
+                        ImGui::SetScrollY(top);
+                    else if (bottom > ImGui::GetScrollY() + height)
+                        ImGui::SetScrollY(bottom - height);
+                    mScrollToCursor = false;
+                }
+
+                ImGuiListClipper clipper(count);
+                while (clipper.Step())
                 {
-                    if (ImGui::Selectable(item->c_str()))
+                    for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
                     {
-                        mSelectedItemIndex = i;
-                        mSelectedItem = *item;
-                        ImGui::CloseCurrentPopup();
-                        result = true;
+                        int index = getShownItem(i);
+                        if (drawItem(index, i == mCursor))
+                        {
+                            mSelectedItemIndex = index;
+                            mSelectedItem = mItems[index];
+                            ImGui::CloseCurrentPopup();
+                            result = true;
+                        }
                     }
-                    item++;
                 }
 
-                if (showedMap.empty())
+                if (count == 0)
                     ImGui::Selectable("Nothing found", false, ImGuiSelectableFlags_Disabled);
 
                 ImGui::ListBoxFooter();
@@ -93,4 +335,4 @@ namespace nap
 
     }
 
-}
\ No newline at end of file
+}
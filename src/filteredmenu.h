@@ -2,12 +2,20 @@
 
 #include <imgui.h>
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
 namespace nap
 {
     namespace edit
     {
         /**
          * Displays a popup menu with a search filter.
+         * Items are matched fuzzily: the characters of the filter have to appear in the item in order, but not necessarily adjacent.
+         * Matches are ranked by how well they fit, matched characters are highlighted.
+         * The filter is only applied when it is edited, the result is kept as indices into the items.
+         * Up and down move the cursor through the results, enter selects the item under the cursor.
          */
         class FilteredMenu
         {
@@ -34,13 +42,59 @@ namespace nap
             const std::string& getSelectedItem() const { return mSelectedItem; }
 
         private:
+            /**
+             * Updates mFilteredItems when the search filter differs from the applied filter. Called from init() and when the filter is edited.
+             * When the new filter extends the applied one only the current matches are scored again.
+             */
+            void updateFilter();
+
+            /**
+             * Matches the lower case filter against an item.
+             * Finds the shortest window at the end of the first match, then scores the characters in it.
+             * Characters at word boundaries and adjacent characters score higher, gaps between characters lower the score.
+             * @param index Index of the item in mItems.
+             * @param filter Lower case filter, not empty.
+             * @param score Receives the score of the match.
+             * @param positions When not null, receives the position in the item of every character of the filter.
+             * @return Whether the item contains all characters of the filter in order.
+             */
+            bool match(int index, const std::string& filter, int& score, int* positions) const;
+
+            /**
+             * Draws an item with the characters that match the filter highlighted.
+             * @return Whether the item was clicked.
+             */
+            bool drawItem(int index, bool selected);
+
+            /**
+             * @return Number of items shown with the current filter.
+             */
+            int getShownCount() const;
+
+            /**
+             * @return Index into mItems of the shown item at the given position.
+             */
+            int getShownItem(int position) const;
+
+            /**
+             * @return Bitmask of the characters in a lower case string, one bit per letter and a few bits for the other characters.
+             */
+            static uint32_t getCharacterMask(const std::string& lowerCase);
+
             std::vector<std::string> mItems;
-            std::vector<std::string> mFilteredItems;
+            std::vector<std::string> mLowerCaseItems;   // Items in lower case, to filter without converting every item
+            std::vector<uint32_t> mMasks;               // Character mask of every item, to skip items that can't match before scoring
+            std::vector<uint8_t> mCandidates;           // Result of the mask test for every item
+            std::vector<int> mScores;                   // Score of every item that matches mAppliedFilter
+            std::vector<int> mFilteredItems;            // Indices into mItems of the items that match mAppliedFilter, best match first
+            std::string mAppliedFilter;                 // Lower case filter mFilteredItems was built with
             char mSearchFilter[128];
+            int mCursor = 0;                            // Position of the keyboard cursor in the shown items
+            bool mScrollToCursor = false;
             int mSelectedItemIndex = -1;
             std::string mSelectedItem;
             bool mFirstShow = true;
         };
     
     }
-}
\ No newline at end of file
+}
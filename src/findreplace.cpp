@@ -0,0 +1,273 @@
+#include "findreplace.h"
+
+#include <rtti/objectptr.h>
+#include <utility/stringutils.h>
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <thread>
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			// Minimum number of resources per scanning thread, fewer are not worth starting a thread for
+			constexpr size_t resourcesPerThread = 256;
+
+			struct ScanSettings
+			{
+				std::string mFind;			// Lower case when not matching case
+				std::string mLowerCaseFind;
+				std::string mReplace;
+				bool mMatchCase = false;
+				bool mIncludeNumbers = false;
+			};
+
+
+			bool isText(const rtti::TypeInfo& type)
+			{
+				return type == RTTI_OF(std::string) || type.is_enumeration() || type.is_arithmetic();
+			}
+
+
+			std::string toText(const rtti::Variant& value)
+			{
+				auto type = value.get_type();
+				if (type == RTTI_OF(std::string))
+					return value.get_value<std::string>();
+				if (type.is_enumeration())
+					return type.get_enumeration().value_to_name(value).to_string();
+				if (type.is_arithmetic())
+					return value.to_string();
+				return std::string();
+			}
+
+
+			// Converts text back to a value of the given type, the result is invalid when the text does not represent a value of the type
+			rtti::Variant toValue(const std::string& text, const rtti::TypeInfo& type)
+			{
+				if (type == RTTI_OF(std::string))
+					return text;
+				if (type.is_enumeration())
+					return type.get_enumeration().name_to_value(text);
+				rtti::Variant value = text;
+				if (!value.convert(type))
+					return rtti::Variant();
+				return value;
+			}
+
+
+			// Finds the search text without converting the text to lower case, so that scanning does not allocate for values that don't match
+			size_t findText(const std::string& text, size_t start, const ScanSettings& settings)
+			{
+				if (settings.mMatchCase)
+					return text.find(settings.mFind, start);
+				auto it = std::search(text.begin() + start, text.end(), settings.mFind.begin(), settings.mFind.end(), [](unsigned char a, unsigned char b){ return std::tolower(a) == b; });
+				return it == text.end() ? std::string::npos : it - text.begin();
+			}
+
+
+			// Replaces every occurrence of the search text, returns false when there is none
+			bool replaceText(const std::string& text, const ScanSettings& settings, std::string& result)
+			{
+				auto position = findText(text, 0, settings);
+				if (position == std::string::npos)
+					return false;
+
+				result.clear();
+				size_t start = 0;
+				while (position != std::string::npos)
+				{
+					result.append(text, start, position - start);
+					result += settings.mReplace;
+					start = position + settings.mFind.size();
+					position = findText(text, start, settings);
+				}
+				result.append(text, start, std::string::npos);
+				return true;
+			}
+
+
+			void scanValue(const rtti::Variant& value, const rtti::Path& path, int arrayIndex, const std::string& mID, const ScanSettings& settings, std::vector<FindReplace::Match>& matches);
+
+
+			void scanProperties(const rtti::Instance& instance, const rtti::TypeInfo& type, const rtti::Path& path, const std::string& mID, const ScanSettings& settings, std::vector<FindReplace::Match>& matches)
+			{
+				for (auto& property : type.get_properties())
+				{
+					// Resources are renamed through the resource list, not by replacing text
+					if (path.getLength() == 0 && property.get_name() == "mID")
+						continue;
+					auto propertyPath = path;
+					propertyPath.pushAttribute(property.get_name().to_string());
+					scanValue(property.get_value(instance), propertyPath, -1, mID, settings, matches);
+				}
+			}
+
+
+			void scanValue(const rtti::Variant& value, const rtti::Path& path, int arrayIndex, const std::string& mID, const ScanSettings& settings, std::vector<FindReplace::Match>& matches)
+			{
+				auto type = value.get_type();
+				if (type == RTTI_OF(std::string))
+				{
+					FindReplace::Match match = { mID, path, arrayIndex, value.get_value<std::string>() };
+					if (replaceText(match.mOldText, settings, match.mNewText))
+						matches.emplace_back(std::move(match));
+				}
+				else if (type.is_enumeration() || type.is_arithmetic())
+				{
+					// Numbers and enums only match as a whole, and only when the replacement is a valid value
+					if (!settings.mIncludeNumbers)
+						return;
+					auto text = toText(value);
+					if (utility::toLower(text) != settings.mLowerCaseFind || !toValue(settings.mReplace, type).is_valid())
+						return;
+					matches.push_back({ mID, path, arrayIndex, text, settings.mReplace });
+				}
+				else if (type.is_derived_from<rtti::ObjectPtrBase>())
+					return;
+				else if (value.is_array())
+				{
+					auto view = value.create_array_view();
+					for (auto i = 0; i < view.get_size(); ++i)
+					{
+						auto element = view.get_value(i);
+						if (isText(element.get_type()))
+							scanValue(element, path, i, mID, settings, matches);
+						else
+						{
+							auto elementPath = path;
+							elementPath.pushArrayElement(i);
+							scanValue(element, elementPath, -1, mID, settings, matches);
+						}
+					}
+				}
+				else if (type.is_class() && !type.is_wrapper())
+					scanProperties(value, type, path, mID, settings, matches);
+			}
+		}
+
+
+		void FindReplace::scan(Model& model, const std::string& find, const std::string& replace, bool matchCase, bool includeNumbers)
+		{
+			mMatches.clear();
+			if (find.empty())
+				return;
+
+			ScanSettings settings;
+			settings.mLowerCaseFind = utility::toLower(find);
+			settings.mFind = matchCase ? find : settings.mLowerCaseFind;
+			settings.mReplace = replace;
+			settings.mMatchCase = matchCase;
+			settings.mIncludeNumbers = includeNumbers;
+
+			// Every thread scans a contiguous range of resources into its own list, the lists are joined in order afterwards
+			auto& resources = model.getResources();
+			size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), resources.size() / resourcesPerThread));
+			std::vector<std::vector<Match>> results(threadCount);
+			auto scanRange = [&](size_t index)
+			{
+				auto begin = resources.size() * index / threadCount;
+				auto end = resources.size() * (index + 1) / threadCount;
+				for (auto i = begin; i < end; ++i)
+				{
+					auto& resource = *resources[i];
+					scanProperties(resource, resource.get_type(), rtti::Path(), resource.mID, settings, results[index]);
+				}
+			};
+
+			std::vector<std::thread> threads;
+			for (size_t i = 1; i < threadCount; ++i)
+				threads.emplace_back(scanRange, i);
+			scanRange(0);
+			for (auto& thread : threads)
+				thread.join();
+
+			size_t count = 0;
+			for (auto& result : results)
+				count += result.size();
+			mMatches.reserve(count);
+			for (auto& result : results)
+				std::move(result.begin(), result.end(), std::back_inserter(mMatches));
+		}
+
+
+		int FindReplace::apply(Controller& controller)
+		{
+			auto& model = *controller.mModel;
+			std::vector<Controller::ValuePath> paths;
+			std::vector<rtti::Variant> values;
+			int count = 0;
+			for (size_t i = 0; i < mMatches.size();)
+			{
+				// Matches in the same array are consecutive. The array is read once, patched and set as a whole.
+				auto& match = mMatches[i];
+				auto end = i + 1;
+				if (match.mArrayIndex >= 0)
+				{
+					auto key = match.mPath.toString();
+					while (end < mMatches.size() && mMatches[end].mArrayIndex >= 0 && mMatches[end].mID == match.mID && mMatches[end].mPath.toString() == key)
+						++end;
+				}
+				auto first = i;
+				i = end;
+
+				if (match.mArrayIndex < 0 && !match.mEnabled)
+					continue;
+				auto resource = model.findResource(match.mID);
+				if (resource == nullptr)
+					continue;
+				Controller::ValuePath path;
+				path.set(match.mPath, resource);
+				if (!path.isResolved())
+					continue;
+
+				// Skip values that were edited after scanning
+				auto value = path.getValue();
+				int replaced = 0;
+				if (match.mArrayIndex < 0)
+				{
+					if (toText(value) != match.mOldText)
+						continue;
+					value = toValue(match.mNewText, value.get_type());
+					if (value.is_valid())
+						replaced = 1;
+				}
+				else
+				{
+					auto view = value.create_array_view();
+					for (auto j = first; j < end; ++j)
+					{
+						auto& element = mMatches[j];
+						if (!element.mEnabled || element.mArrayIndex >= view.get_size())
+							continue;
+						auto oldValue = view.get_value(element.mArrayIndex);
+						if (toText(oldValue) != element.mOldText)
+							continue;
+						auto newValue = toValue(element.mNewText, oldValue.get_type());
+						if (newValue.is_valid() && view.set_value(element.mArrayIndex, newValue))
+							replaced++;
+					}
+				}
+				if (replaced == 0)
+					continue;
+
+				paths.emplace_back(std::move(path));
+				values.emplace_back(std::move(value));
+				count += replaced;
+			}
+			mMatches.clear();
+
+			if (count > 0)
+				controller.setValues(std::move(paths), values);
+			return count;
+		}
+
+	}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "controller.h"
+
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Finds values in the properties of all resources and replaces them as one undoable edit.
+		 * Text in string properties is replaced wherever it occurs. Numbers and enums are replaced when their whole value equals the search text.
+		 * The resources are scanned in parallel, the matches can be reviewed and deselected before they are applied.
+		 */
+		class NAPAPI FindReplace
+		{
+		public:
+			/**
+			 * A value that contains the search text.
+			 */
+			struct Match
+			{
+				std::string mID;					// Resource that contains the value
+				rtti::Path mPath;					// Path to the value, or to the array that contains it
+				int mArrayIndex = -1;				// Index of the value in the array, -1 if the value is not an array element
+				std::string mOldText;				// Current value as text
+				std::string mNewText;				// Value as text after replacing
+				bool mEnabled = true;				// Whether the match is replaced when applied
+			};
+
+			/**
+			 * Scans all resources of the model for values that contain the search text. Replaces the matches of a previous scan.
+			 * The model must not be edited while scanning, the calling thread waits for all scanning threads to finish.
+			 * @param model The model to scan.
+			 * @param find Text to find, nothing is found when empty.
+			 * @param replace Text to replace it with.
+			 * @param matchCase Whether letters have to match in case.
+			 * @param includeNumbers Whether numeric and enum values are scanned as well as strings.
+			 */
+			void scan(Model& model, const std::string& find, const std::string& replace, bool matchCase, bool includeNumbers);
+
+			/**
+			 * Replaces the enabled matches through the controller, as one undo step.
+			 * Matches of which the value was changed or removed since scanning are skipped. The matches are cleared afterwards.
+			 * @param controller The controller to edit the model with.
+			 * @return Number of values that were replaced.
+			 */
+			int apply(Controller& controller);
+
+			/**
+			 * Removes all matches.
+			 */
+			void clear() { mMatches.clear(); }
+
+			/**
+			 * @return Matches of the last scan.
+			 */
+			std::vector<Match>& getMatches() { return mMatches; }
+
+		private:
+			std::vector<Match> mMatches;
+		};
+
+	}
+}
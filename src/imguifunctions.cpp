@@ -22,6 +22,21 @@ namespace nap
 		}
 
 
+		bool TreeNodeArrow(const char *label, bool& open)
+		{
+			ImGui::PushStyleColor(ImGuiCol_HeaderHovered, ImVec4(0.f, 0.f, 0.f, 0.f));
+			ImGui::PushStyleColor(ImGuiCol_HeaderActive, ImVec4(0.f, 0.f, 0.f, 0.f));
+			ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_OpenOnArrow | ImGuiTreeNodeFlags_AllowItemOverlap | ImGuiTreeNodeFlags_NoTreePushOnOpen;
+			ImGui::SetNextItemOpen(open);
+			bool opened = ImGui::TreeNodeEx(label, flags);
+			ImGui::PopStyleColor();
+			ImGui::PopStyleColor();
+			bool toggled = opened != open;
+			open = opened;
+			return toggled;
+		}
+
+
 		bool Selectable(const char *label, bool selected, float width)
 		{
 			bool result = false;
@@ -16,6 +16,15 @@ namespace nap
 		 */
 		bool TreeNodeArrow(const char* label, bool defaultOpen = false);
 
+		/**
+		 * Display tree node arrow of which the open state is kept by the caller.
+		 * Does not push onto the ImGui tree stack, so no TreePop() is needed and the node can be drawn without its parents.
+		 * @param label Unique label for the widget for internal use by ImGui.
+		 * @param open Whether the tree node is opened, toggled when the arrow is clicked.
+		 * @return True when the open state was toggled
+		 */
+		bool TreeNodeArrow(const char* label, bool& open);
+
 		/**
 		 * Display a selectable item with a label
 		 * @param label Label text
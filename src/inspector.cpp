@@ -63,29 +63,62 @@ namespace nap
             ImGui::PopStyleColor();
 
             if (mResourceSelector->empty())
+            {
+                mController->commitEdit();
                 return;
+            }
 
             ImGui::SetNextWindowBgAlpha(0.1);
             ImGui::BeginChild("##InspectorChild", ImVec2(0, 0), true);
             ImGui::SetCursorPosY(ImGui::GetCursorPosY() + mLayoutConstants->listOffset());
 
+            if (mResourceSelector->size() > 1)
+            {
+                mSelection.clear();
+                mSelectionRangeEnd = -1;
+                mInspectedResourceID.clear();
+                mEditActive = false;
+                ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(5, 0));
+                drawMultiple(nameOffset, valueOffset, typeOffset);
+                ImGui::PopStyleVar();
+                if (!mEditActive)
+                    mController->commitEdit();
+                ImGui::EndChild();
+                return;
+            }
+
             // Check if selected resource has changed
             if (mResourceSelector->get() != mInspectedResourceID)
             {
                 mSelection.clear();
+                mSelectionRangeEnd = -1;
                 mInspectedResourceID = mResourceSelector->get();
                 mInspectedResource = mModel->findResource(mResourceSelector->get());
                 assert(mInspectedResource != nullptr);
             }
 
+            // Derived resources show their template, overridden properties can be reverted from the context menu
+            auto derivation = mModel->getDerivation(mInspectedResourceID);
+            if (derivation != nullptr)
+            {
+                ImGui::SetCursorPosX(nameOffset);
+                ImGui::TextDisabled("Derived from %s, %d overrides", derivation->mTemplateID.c_str(), int(derivation->mOverrides.size()));
+            }
+
             // Draw selected resource
             rtti::Path path;
             rtti::Variant var = mInspectedResource;
             rtti::TypeInfo type = mInspectedResource->get_type();
+            mEditActive = false;
+            updateValueCache();
             ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(5, 0));
             drawObject(var, type, path, nameOffset, valueOffset, typeOffset);
             ImGui::PopStyleVar();
 
+            // Commit the running edit session once the user releases the editor widget, so that a drag results in a single undo step
+            if (!mEditActive)
+                mController->commitEdit();
+
             ImGui::EndChild();
 
             // Popup resource selection
@@ -139,22 +172,35 @@ namespace nap
                     ImGui::SetNextWindowBgAlpha(0.5f);
                     if (ImGui::BeginPopupContextItem("##ResourcesListPopupContextItem", ImGuiMouseButton_Right))
                     {
-                        if (ImGui::Selectable("Remove Element"))
-                            removeArrayElement();
-
-                        if (ImGui::Selectable("Insert Element"))
-                            insertArrayElement();
-
                         auto array = mSelection.getResolvedPath().getValue();
                         auto view = array.create_array_view();
-                        if (mSelection.getArrayIndex() < view.get_size() - 1)
-                            if (ImGui::Selectable("Move Element Down"))
+                        auto elementType = view.get_rank_type(1);
+                        bool isRange = getSelectionLast() > getSelectionFirst();
+
+                        if (ImGui::Selectable(isRange ? "Remove Elements" : "Remove Element"))
+                            removeArrayElement();
+
+                        if (!isRange)
+                        {
+                            if (ImGui::Selectable("Insert Element"))
+                                insertArrayElement();
+                        }
+                        else if (!elementType.is_derived_from<rtti::ObjectPtrBase>())
+                        {
+                            if (ImGui::Selectable("Insert Elements"))
+                                mController->insertArrayElements(mSelection, getSelectionFirst(), getSelectionLast() - getSelectionFirst() + 1);
+                        }
+
+                        if (getSelectionLast() < view.get_size() - 1)
+                            if (ImGui::Selectable(isRange ? "Move Elements Down" : "Move Element Down"))
                                 moveArrayElementDown();
 
-                        if (mSelection.getArrayIndex() > 0)
-                            if (ImGui::Selectable("Move Element Up"))
+                        if (getSelectionFirst() > 0)
+                            if (ImGui::Selectable(isRange ? "Move Elements Up" : "Move Element Up"))
                                 moveArrayElementUp();
 
+                        drawSortMenu(elementType);
+
                         ImGui::EndPopup();
                     }
                 }
@@ -165,9 +211,141 @@ namespace nap
                         if (ImGui::Selectable("Add Element"))
                             addArrayElement();
 
+                        auto array = mSelection.getResolvedPath().getValue();
+                        drawSortMenu(array.create_array_view().get_rank_type(1));
+
                         ImGui::EndPopup();
                     }
                 }
+                else if (mSelection.getPath().getLength() == 1)
+                {
+                    auto derivation = mModel->getDerivation(mSelection.getRootID());
+                    auto propertyName = mSelection.getRootProperty();
+                    if (derivation != nullptr && derivation->mOverrides.find(propertyName) != derivation->mOverrides.end())
+                    {
+                        if (ImGui::BeginPopupContextItem("##ResourcesListPopupContextItem", ImGuiMouseButton_Right))
+                        {
+                            if (ImGui::Selectable("Revert to Template"))
+                                mController->revertOverride(mSelection.getRootID(), propertyName);
+                            ImGui::EndPopup();
+                        }
+                    }
+                }
+            }
+        }
+
+
+        void Inspector::drawMultiple(float nameOffset, float valueOffset, float typeOffset)
+        {
+            updateCommonProperties();
+
+            ImGui::SetCursorPosX(nameOffset);
+            ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+            ImGui::Text("%d resources selected", int(mCommonResources.size()));
+            ImGui::PopStyleColor();
+
+            // Values are shown from the lead selection
+            auto lead = mModel->findResource(mResourceSelector->get());
+            auto valueWidth = typeOffset - valueOffset - mLayoutConstants->valueSpacing();
+            for (auto& common : mCommonProperties)
+            {
+                auto& property = common.mProperty;
+                auto name = property.get_name().to_string();
+                auto type = property.get_type();
+                auto value = property.get_value(*lead);
+
+                ImGui::SetCursorPosX(nameOffset);
+                ImGui::Text(name.c_str());
+                ImGui::SameLine();
+
+                // Mixed values are drawn dimmed, editing them sets the same value on all resources
+                ImGui::SetCursorPosX(valueOffset);
+                if (common.mMixed)
+                    ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+                bool valueChanged = false;
+                auto propertyEditor = mPropertyEditors.find(type);
+                if (propertyEditor != mPropertyEditors.end())
+                {
+                    std::string label = "##Multiple" + name;
+                    valueChanged = propertyEditor->second->drawValue(value, label, valueWidth);
+                    if (ImGui::IsItemActive())
+                        mEditActive = true;
+                }
+                else
+                    valueChanged = drawEnum(value, type, rtti::Path(), "Multiple" + name, valueWidth);
+                if (common.mMixed)
+                    ImGui::PopStyleColor();
+                ImGui::SameLine();
+
+                ImGui::SetCursorPosX(typeOffset);
+                ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+                ImGui::Text(common.mMixed ? "Mixed" : type.get_name().to_string().c_str());
+                ImGui::PopStyleColor();
+
+                if (valueChanged)
+                {
+                    if (common.mPaths.empty())
+                    {
+                        rtti::Path path;
+                        path.pushAttribute(name);
+                        common.mPaths.resize(mCommonResources.size());
+                        for (auto i = 0; i < mCommonResources.size(); ++i)
+                            common.mPaths[i].set(path, mCommonResources[i]);
+                    }
+                    mController->updateEdit(common.mPaths, value);
+                }
+            }
+        }
+
+
+        void Inspector::updateCommonProperties()
+        {
+            // Rebuild the list of common properties when the selection or the set of resources changed
+            if (!mCommonPropertiesValid || mCommonSelectorVersion != mResourceSelector->getVersion() || mCommonStructureGeneration != mModel->getStructureGeneration())
+            {
+                mCommonProperties.clear();
+                mCommonResources.clear();
+                std::vector<rtti::TypeInfo> types;
+                for (auto& mID : mResourceSelector->getAll())
+                {
+                    auto resource = mModel->findResource(mID);
+                    assert(resource != nullptr);
+                    mCommonResources.emplace_back(resource);
+                    auto type = resource->get_type();
+                    if (std::find(types.begin(), types.end(), type) == types.end())
+                        types.emplace_back(type);
+                }
+
+                // Only properties that are edited with a single widget can be edited on all resources at once
+                auto lead = mModel->findResource(mResourceSelector->get());
+                for (auto& property : lead->get_type().get_properties())
+                {
+                    auto name = property.get_name().to_string();
+                    auto type = property.get_type();
+                    if (name == "mID")
+                        continue;
+                    if (mPropertyEditors.find(type) == mPropertyEditors.end() && !type.is_enumeration())
+                        continue;
+                    bool shared = std::all_of(types.begin(), types.end(), [&](const rtti::TypeInfo& other) { return other.get_property(name) == property; });
+                    if (shared)
+                        mCommonProperties.push_back({ property, false, {} });
+                }
+
+                mCommonSelectorVersion = mResourceSelector->getVersion();
+                mCommonStructureGeneration = mModel->getStructureGeneration();
+                mCommonPropertiesValid = true;
+                mCommonGeneration = mModel->getGeneration() - 1;
+            }
+
+            // Recompute the mixed flags when any value changed
+            if (mCommonGeneration != mModel->getGeneration())
+            {
+                for (auto& common : mCommonProperties)
+                {
+                    auto first = common.mProperty.get_value(*mCommonResources.front());
+                    common.mMixed = std::any_of(mCommonResources.begin() + 1, mCommonResources.end(), [&](Resource* resource) { return common.mProperty.get_value(*resource) != first; });
+                }
+                mCommonGeneration = mModel->getGeneration();
             }
         }
 
@@ -176,19 +354,18 @@ namespace nap
         {
             for (auto& property : type.get_properties())
             {
-                auto propertyValue = property.get_value(object);
                 auto propertyType = property.get_type();
                 auto propertyName = property.get_name().to_string();
                 bool embeddedPointer = rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded);
+                rtti::Path path = aPath;
+                path.pushAttribute(propertyName);
+                auto& propertyValue = readProperty(property, object, path);
 
                 if (drawValue(propertyValue, propertyType, aPath, propertyName, false, 0, embeddedPointer, nameOffset, valueOffset, typeOffset))
                 {
-                    // property.set_value(object, propertyValue);
                     Controller::ValuePath valuePath;
-                    rtti::Path path = aPath;
-                    path.pushAttribute(propertyName);
                     valuePath.set(path, mInspectedResource.get());
-                    mController->setValue(valuePath, propertyValue);
+                    editValue(valuePath, propertyValue);
                 }
             }
         }
@@ -221,13 +398,20 @@ namespace nap
                 ImGui::SetCursorPosX(nameOffset);
 
             // Draw name
-            bool selected = (mSelection.getPath() == path);
+            bool selected = isArrayElement ? isElementSelected(parentPath, arrayIndex) : (!mSelection.isArrayElement() && mSelection.getPath() == path);
             if (Selectable(name.c_str(), selected, valueOffset - ImGui::GetCursorPosX() - mLayoutConstants->valueSpacing()))
             {
-                if (isArrayElement)
-                    mSelection.set(parentPath, arrayIndex, mInspectedResource.get());
+                // Shift-click extends the selection to a range of elements within the same array
+                if (isArrayElement && ImGui::GetIO().KeyShift && mSelection.isResolved() && mSelection.isArrayElement() && mSelection.getPath() == parentPath)
+                    mSelectionRangeEnd = arrayIndex;
                 else
-                    mSelection.set(path, mInspectedResource.get());
+                {
+                    mSelectionRangeEnd = -1;
+                    if (isArrayElement)
+                        mSelection.set(parentPath, arrayIndex, mInspectedResource.get());
+                    else
+                        mSelection.set(path, mInspectedResource.get());
+                }
             }
             ImGui::SameLine();
 
@@ -243,6 +427,8 @@ namespace nap
                 std::string label = "##" + parentPath.toString() + name;
                 if (propertyEditor->second->drawValue(value, label, valueWidth))
                     valueChanged = true;
+                if (ImGui::IsItemActive())
+                    mEditActive = true;
             }
             else if (type.is_enumeration())
             {
@@ -273,9 +459,8 @@ namespace nap
             {
                 if (type.is_array())
                 {
-                    // Draw array elements
-                    if (drawArray(value, path, name, isEmbeddedPointer, nameOffset + mLayoutConstants->nameColumnIndent(), valueOffset, typeOffset))
-                        valueChanged = true;
+                    // Draw array elements, they are edited one by one
+                    drawArray(value, path, name, isEmbeddedPointer, nameOffset + mLayoutConstants->nameColumnIndent(), valueOffset, typeOffset);
                 }
                 else if (isEmbeddedObject)
                 {
@@ -298,21 +483,91 @@ namespace nap
         }
 
 
-        bool Inspector::drawArray(rtti::Variant &var, const rtti::Path& path, const std::string &name, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset)
+        void Inspector::drawArray(rtti::Variant &var, const rtti::Path& path, const std::string &name, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset)
         {
-            bool valueChanged = false;
             assert(var.is_array());
             auto array = var.create_array_view();
-            for (auto i = 0; i < array.get_size(); ++i)
+            int size = array.get_size();
+
+            // Huge arrays are shown a page at a time
+            int first = 0;
+            int last = size;
+            if (size > sArrayPageSize)
             {
-                auto element = array.get_value(i);
-                if (drawValue(element, element.get_type(), path, std::to_string(i), true, i, isEmbeddedPointerArray, nameOffset, valueOffset, typeOffset))
-                {
-                    array.set_value(i, element);
-                    valueChanged = true;
-                }
+                auto& page = mArrayPages[path.toString()];
+                drawArrayPager(page, size, nameOffset, valueOffset);
+                first = page;
+                last = std::min(size, first + sArrayPageSize);
             }
-            return valueChanged;
+
+            // Elements that are not expanded are a single row, runs of them are drawn through the clipper so only the visible ones are read and drawn.
+            // Expanded elements are drawn in full between the runs.
+            auto elementType = array.get_rank_type(1);
+            bool isExpandable = (mPropertyEditors.find(elementType) == mPropertyEditors.end() && elementType.is_class() && !elementType.is_wrapper()) ||
+                (isEmbeddedPointerArray && elementType.is_derived_from<rtti::ObjectPtrBase>());
+            int runStart = first;
+            for (auto i = first; i <= last; ++i)
+            {
+                if (i < last && !(isExpandable && isElementOpen(i)))
+                    continue;
+
+                ImGuiListClipper clipper;
+                clipper.Begin(i - runStart);
+                while (clipper.Step())
+                    for (auto j = clipper.DisplayStart; j < clipper.DisplayEnd; ++j)
+                        drawArrayElement(array, path, runStart + j, isEmbeddedPointerArray, nameOffset, valueOffset, typeOffset);
+
+                if (i < last)
+                    drawArrayElement(array, path, i, isEmbeddedPointerArray, nameOffset, valueOffset, typeOffset);
+                runStart = i + 1;
+            }
+        }
+
+
+        void Inspector::drawArrayElement(rtti::VariantArray& array, const rtti::Path& path, int index, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset)
+        {
+            // Elements are read from the cached array, only the visible ones and without a cache entry of their own
+            auto element = array.get_value(index);
+            if (drawValue(element, element.get_type(), path, std::to_string(index), true, index, isEmbeddedPointerArray, nameOffset, valueOffset, typeOffset))
+            {
+                // Edit the element only, so that the undo step records the element instead of the whole array.
+                // The new value is written into the cached array, which then stays valid.
+                Controller::ValuePath elementPath;
+                elementPath.set(path, index, mInspectedResource.get());
+                array.set_value(index, element);
+                editValue(elementPath, element);
+            }
+        }
+
+
+        void Inspector::drawArrayPager(int& first, int size, float nameOffset, float valueOffset)
+        {
+            ImGui::SetCursorPosX(nameOffset);
+            ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+            ImGui::Text("%d - %d of %d", first, std::min(first + sArrayPageSize, size) - 1, size);
+            ImGui::PopStyleColor();
+            ImGui::SameLine();
+
+            // Page through the elements, or type the index of the first element to show
+            ImGui::SetCursorPosX(valueOffset);
+            if (ImGui::ArrowButton("##PreviousPage", ImGuiDir_Left))
+                first -= sArrayPageSize;
+            ImGui::SameLine();
+            if (ImGui::ArrowButton("##NextPage", ImGuiDir_Right))
+                first += sArrayPageSize;
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(100.f * mGuiService->getScale());
+            ImGui::InputInt("##FirstElement", &first, 0, 0, ImGuiInputTextFlags_EnterReturnsTrue);
+            first = std::max(0, std::min(first, size - 1));
+        }
+
+
+        bool Inspector::isElementOpen(int index) const
+        {
+            // The tree node of an element is labeled by its index, see drawValue()
+            char label[32];
+            snprintf(label, sizeof(label), "###%d", index);
+            return ImGui::GetStateStorage()->GetInt(ImGui::GetID(label), 0) != 0;
         }
 
 
@@ -406,13 +661,65 @@ namespace nap
             if (ImGui::InputText(label.c_str(), buffer, sizeof(buffer), ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll))
             {
                 auto newID = std::string(buffer);
-                mModel->renameResource(oldID, newID);
-                if (parentPath.getLength() == 0) // Are we editing the ID of the selected resource?
-                    mResourceSelector->set(newID);
+                if (mController->renameResource(oldID, newID))
+                    if (parentPath.getLength() == 0) // Are we editing the ID of the selected resource?
+                        mResourceSelector->set(newID);
+            }
+        }
+
+
+        rtti::Variant& Inspector::readProperty(const rtti::Property& property, const rtti::Instance& object, const rtti::Path& path)
+        {
+            auto key = path.toString();
+            auto it = mValueCache.find(key);
+            if (it == mValueCache.end())
+                it = mValueCache.emplace(std::move(key), property.get_value(object)).first;
+            return it->second;
+        }
+
+
+        void Inspector::editValue(Controller::ValuePath& path, const rtti::Variant& value)
+        {
+            // When the cache was up to date before the edit, only the edited property is out of date after it
+            bool tracked = mModel->getGeneration() == mValueCacheGeneration;
+            mController->updateEdit(path, value);
+            if (tracked)
+            {
+                // An edited element is already written into the cached array, only the values cached below it are out of date
+                mValueCacheGeneration = mModel->getGeneration();
+                if (path.isArrayElement())
+                    mEditedKeys.emplace_back(path.getPath().toString() + "/" + std::to_string(path.getArrayIndex()));
+                else
+                    mEditedKeys.emplace_back(path.getRootProperty());
             }
         }
 
 
+        void Inspector::updateValueCache()
+        {
+            if (mValueCacheResource != mInspectedResource.get() || mValueCacheGeneration != mModel->getGeneration())
+            {
+                mValueCache.clear();
+                mValueCacheResource = mInspectedResource.get();
+                mValueCacheGeneration = mModel->getGeneration();
+            }
+            else
+            {
+                // Values are edited in the cache while drawing, drop them once the frame is done with them so they are read again
+                for (auto& edited : mEditedKeys)
+                {
+                    for (auto it = mValueCache.begin(); it != mValueCache.end();)
+                    {
+                        auto& key = it->first;
+                        bool below = key.compare(0, edited.size(), edited) == 0 && (key.size() == edited.size() || key[edited.size()] == '/');
+                        it = below ? mValueCache.erase(it) : std::next(it);
+                    }
+                }
+            }
+            mEditedKeys.clear();
+        }
+
+
         void Inspector::insertArrayElement()
         {
             auto array = mSelection.getResolvedPath().getValue();
@@ -434,24 +741,90 @@ namespace nap
 
         void Inspector::removeArrayElement()
         {
-            mController->removeArrayElement(mSelection);
+            if (getSelectionLast() > getSelectionFirst())
+                mController->removeArrayElements(mSelection, getSelectionFirst(), getSelectionLast() + 1);
+            else
+                mController->removeArrayElement(mSelection);
             mSelection.clear();
+            mSelectionRangeEnd = -1;
         }
 
 
         void Inspector::moveArrayElementUp()
         {
-            mController->moveArrayElementUp(mSelection);
-            auto arrayPath = mSelection.getPath();
-            mSelection.set(arrayPath, mSelection.getArrayIndex() - 1, mInspectedResource.get());
+            auto first = getSelectionFirst();
+            auto last = getSelectionLast();
+            if (last > first)
+                mController->moveArrayElements(mSelection, first, last + 1, first - 1);
+            else
+                mController->moveArrayElementUp(mSelection);
+            selectElements(first - 1, last - 1);
         }
 
 
         void Inspector::moveArrayElementDown()
         {
-            mController->moveArrayElementDown(mSelection);
+            auto first = getSelectionFirst();
+            auto last = getSelectionLast();
+            if (last > first)
+                mController->moveArrayElements(mSelection, first, last + 1, first + 1);
+            else
+                mController->moveArrayElementDown(mSelection);
+            selectElements(first + 1, last + 1);
+        }
+
+
+        void Inspector::drawSortMenu(const rtti::TypeInfo& elementType)
+        {
+            // Only values with a registered comparison can be sorted, pointers, nested structs and arrays have no meaningful order
+            if (Controller::isSortKey(elementType))
+            {
+                if (ImGui::Selectable("Sort Ascending"))
+                    mController->sortArray(mSelection);
+                return;
+            }
+
+            if (!elementType.is_class() || elementType.is_wrapper())
+                return;
+            std::vector<std::string> keys;
+            for (auto& property : elementType.get_properties())
+                if (Controller::isSortKey(property.get_type()))
+                    keys.emplace_back(property.get_name().to_string());
+            if (!keys.empty() && ImGui::BeginMenu("Sort By"))
+            {
+                for (auto& key : keys)
+                    if (ImGui::Selectable(key.c_str()))
+                        mController->sortArray(mSelection, key);
+                ImGui::EndMenu();
+            }
+        }
+
+
+        bool Inspector::isElementSelected(const rtti::Path& arrayPath, int index) const
+        {
+            if (!mSelection.isResolved() || !mSelection.isArrayElement() || !(mSelection.getPath() == arrayPath))
+                return false;
+            return index >= getSelectionFirst() && index <= getSelectionLast();
+        }
+
+
+        int Inspector::getSelectionFirst() const
+        {
+            return mSelectionRangeEnd < 0 ? mSelection.getArrayIndex() : std::min(mSelection.getArrayIndex(), mSelectionRangeEnd);
+        }
+
+
+        int Inspector::getSelectionLast() const
+        {
+            return mSelectionRangeEnd < 0 ? mSelection.getArrayIndex() : std::max(mSelection.getArrayIndex(), mSelectionRangeEnd);
+        }
+
+
+        void Inspector::selectElements(int first, int last)
+        {
             auto arrayPath = mSelection.getPath();
-            mSelection.set(arrayPath, mSelection.getArrayIndex() + 1, mInspectedResource.get());
+            mSelection.set(arrayPath, first, mInspectedResource.get());
+            mSelectionRangeEnd = last > first ? last : -1;
         }
 
 
@@ -516,6 +889,7 @@ namespace nap
                 mInspectedResource = mModel->findResource(mInspectedResourceID);
                 assert(mInspectedResource != nullptr);
                 mSelection.clear();
+                mSelectionRangeEnd = -1;
             }
         }
 
@@ -41,18 +41,36 @@
 
             void drawContextMenu();
 
+            // Draws the common properties of all selected resources when more than one resource is selected
+            void drawMultiple(float nameOffset, float valueOffset, float typeOffset);
+            void updateCommonProperties();
+
             void drawObject(rtti::Variant& object, rtti::TypeInfo type, const rtti::Path& path, float nameOffset, float valueOffset, float typeOffset);
             bool drawValue(rtti::Variant& value, rtti::TypeInfo type, const rtti::Path& path, const std::string& name, bool isArrayElement, int arrayIndex, bool isEmbeddedPointer, float nameOffset, float valueOffset, float typeOffset);
-            bool drawArray(rtti::Variant& array, const rtti::Path& path, const std::string& name, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset);
+            void drawArray(rtti::Variant& array, const rtti::Path& path, const std::string& name, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset);
+            void drawArrayElement(rtti::VariantArray& array, const rtti::Path& path, int index, bool isEmbeddedPointerArray, float nameOffset, float valueOffset, float typeOffset);
+            void drawArrayPager(int& first, int size, float nameOffset, float valueOffset);
+            bool isElementOpen(int index) const;
             bool drawEnum(rtti::Variant& var, rtti::TypeInfo type, const rtti::Path& path, const std::string& name, float valueWidth);
             void drawPointer(rtti::Variant& var, rtti::TypeInfo type, const rtti::Path& path, const std::string& name, bool isEmbedded, float valueWidth);
             void drawID(rtti::Variant& value, const rtti::Path& parentPath, float width);
 
+            // Cached values of the inspected resource, see mValueCache
+            rtti::Variant& readProperty(const rtti::Property& property, const rtti::Instance& object, const rtti::Path& path);
+            void editValue(Controller::ValuePath& path, const rtti::Variant& value);
+            void updateValueCache();
+
             void insertArrayElement();
             void removeArrayElement();
             void moveArrayElementUp();
             void moveArrayElementDown();
             void addArrayElement();
+            void drawSortMenu(const rtti::TypeInfo& elementType);
+
+            bool isElementSelected(const rtti::Path& arrayPath, int index) const;
+            int getSelectionFirst() const;
+            int getSelectionLast() const;
+            void selectElements(int first, int last);
 
             void addArrayPtrElement(Resource* resource);
             void choosePointer(const rtti::TypeInfo& type);
@@ -64,14 +82,42 @@
             std::string mInspectedResourceID;
             ResourcePtr<Resource> mInspectedResource;
             Controller::ValuePath mSelection;
+            int mSelectionRangeEnd = -1; // Index of the other end of a shift-click range of array elements, -1 when a single item is selected
             FilteredMenu mFilteredMenu;
             bool mOpenResourceMenu = false;
             bool mOpenResourceTypeMenu = false;
+            bool mEditActive = false; // True when a property editor widget is being edited this frame
             IMGuiService* mGuiService = nullptr;
             ResourcePtr<Model> mModel;
 
             std::map<const rtti::TypeInfo, std::unique_ptr<IPropertyEditor>> mPropertyEditors;
 
+            // Values read from the inspected resource by path, so that properties, arrays and structs are not copied from the resource every frame.
+            // Array elements are read from the cached array. Edits made by the inspector only drop the values of the edited property,
+            // an edited element is written into the cached array and only drops the values below it. Any other change of the model drops all values.
+            std::unordered_map<std::string, rtti::Variant> mValueCache;
+            const Resource* mValueCacheResource = nullptr;      // Resource the cached values were read from
+            uint64_t mValueCacheGeneration = 0;                 // Model generation the cached values are valid for
+            std::vector<std::string> mEditedKeys;               // Keys of the values edited by the inspector during this frame, values below them are dropped
+
+            // Arrays with more elements than this are shown a page at a time
+            static constexpr int sArrayPageSize = 1000;
+            std::unordered_map<std::string, int> mArrayPages;   // Index of the first shown element of paged arrays, by path
+
+            // A property shared by all selected resources
+            struct CommonProperty
+            {
+                rtti::Property mProperty;
+                bool mMixed = false;                            // The selected resources have different values for the property
+                std::vector<Controller::ValuePath> mPaths;      // Path to the property in each selected resource, created on the first edit
+            };
+            std::vector<CommonProperty> mCommonProperties;
+            std::vector<Resource*> mCommonResources;            // The selected resources, in selection order
+            uint64_t mCommonSelectorVersion = 0;                // Selector version mCommonProperties was built for
+            uint64_t mCommonStructureGeneration = 0;            // Model structure generation mCommonProperties was built for
+            uint64_t mCommonGeneration = 0;                     // Model generation the mixed flags were computed for
+            bool mCommonPropertiesValid = false;
+
             Core& mCore;
         };
 
@@ -0,0 +1,617 @@
+#include "journal.h"
+#include "objectutils.h"
+
+#include <nap/logger.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#endif
+
+RTTI_BEGIN_CLASS(nap::edit::Journal)
+    RTTI_PROPERTY("Model", &nap::edit::Journal::mModel, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("Controller", &nap::edit::Journal::mController, nap::rtti::EPropertyMetaData::Required)
+    RTTI_PROPERTY("Path", &nap::edit::Journal::mPath, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("IdleCheckpointDelay", &nap::edit::Journal::mIdleCheckpointDelay, nap::rtti::EPropertyMetaData::Default)
+    RTTI_PROPERTY("CheckpointCommands", &nap::edit::Journal::mCheckpointCommands, nap::rtti::EPropertyMetaData::Default)
+RTTI_END_CLASS
+
+namespace nap
+{
+
+    namespace edit
+    {
+
+        namespace
+        {
+            // Length prefixed strings and counts in delta records
+            void writeBinary(std::vector<uint8_t>& output, uint32_t value)
+            {
+                auto bytes = reinterpret_cast<const uint8_t*>(&value);
+                output.insert(output.end(), bytes, bytes + sizeof(value));
+            }
+
+            void writeBinary(std::vector<uint8_t>& output, const std::string& value)
+            {
+                writeBinary(output, uint32_t(value.size()));
+                output.insert(output.end(), value.begin(), value.end());
+            }
+
+            // Reading advances data, fails when the value does not fit before end
+            bool readBinary(const uint8_t*& data, const uint8_t* end, uint32_t& value)
+            {
+                if (size_t(end - data) < sizeof(value))
+                    return false;
+                std::memcpy(&value, data, sizeof(value));
+                data += sizeof(value);
+                return true;
+            }
+
+            bool readBinary(const uint8_t*& data, const uint8_t* end, uint8_t& value)
+            {
+                if (data == end)
+                    return false;
+                value = *data++;
+                return true;
+            }
+
+            bool readBinary(const uint8_t*& data, const uint8_t* end, std::string& value)
+            {
+                uint32_t size;
+                if (!readBinary(data, end, size) || size_t(end - data) < size)
+                    return false;
+                value.assign(reinterpret_cast<const char*>(data), size);
+                data += size;
+                return true;
+            }
+
+            // Record layout: type, payload size, payload
+            void writeRecord(std::ofstream& file, uint8_t type, const uint8_t* payload, uint32_t size)
+            {
+                file.write(reinterpret_cast<const char*>(&type), sizeof(type));
+                file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+                file.write(reinterpret_cast<const char*>(payload), size);
+            }
+        }
+
+
+        Journal::~Journal()
+        {
+            // The journal is kept: without a call to close() the editor did not exit cleanly
+            stop();
+        }
+
+
+        bool Journal::init(utility::ErrorState& errorState)
+        {
+            if (!readJournal(errorState))
+                return false;
+
+            mModel->mChangedSignal.connect(mModelChangedSlot);
+            mModel->mClearedSignal.connect(mModelClearedSlot);
+            mModel->mResourceAddedSignal.connect(mResourceAddedSlot);
+            mModel->mResourceEditedSignal.connect(mResourceEditedSlot);
+            mModel->mResourceRemovedSignal.connect(mResourceRemovedSlot);
+            mModel->mResourceRenamedSignal.connect(mResourceRenamedSlot);
+            resetChanges();
+            mThread = std::thread([this](){ writeThread(); });
+            return true;
+        }
+
+
+        void Journal::update()
+        {
+            // The previous journal is kept until it is recovered or discarded.
+            // Nothing is journaled during an edit session, the session is journaled as a whole when it ends.
+            if (mHasRecovery || mController->isEditing())
+                return;
+
+            if (mDirty && !mNeedsCheckpoint)
+                writeDelta();
+
+            auto idle = std::chrono::duration<float>(std::chrono::steady_clock::now() - mLastChange).count();
+            if (mNeedsCheckpoint || (mDeltaCount > 0 && (mDeltaCount >= mCheckpointCommands || idle >= mIdleCheckpointDelay)))
+                checkpoint();
+        }
+
+
+        bool Journal::recover(std::string& savedPath, utility::ErrorState& errorState)
+        {
+            assert(mHasRecovery);
+            savedPath = mRecoveredPath;
+
+            bool success;
+            if (!mRecoveredCheckpoint.empty())
+                success = mModel->deserializeBinary(reinterpret_cast<const uint8_t*>(mRecoveredCheckpoint.data()), mRecoveredCheckpoint.size(), errorState);
+            else if (!mRecoveredPath.empty())
+                success = mModel->loadFromFile(mRecoveredPath, errorState);
+            else
+            {
+                // The deltas were journaled after a new model was created
+                mModel->clear();
+                success = true;
+            }
+
+            // Apply the commands that were journaled after the checkpoint, in order
+            for (auto i = 0; success && i < mRecoveredDeltas.size(); ++i)
+                success = applyDelta(mRecoveredDeltas[i], errorState);
+
+            mRecoveredPath.clear();
+            mRecoveredCheckpoint.clear();
+            mRecoveredCheckpoint.shrink_to_fit();
+            mRecoveredDeltas.clear();
+            mRecoveredDeltas.shrink_to_fit();
+            if (!success)
+                return false;
+            mModel->notifyChanged();
+
+            // Start a new journal for the recovered state, so that it survives another crash
+            compact(savedPath);
+            checkpoint();
+            return true;
+        }
+
+
+        void Journal::compact(const std::string& savedPath)
+        {
+            mHasRecovery = false;
+            post(ERecordType::SavedPath, std::vector<uint8_t>(savedPath.begin(), savedPath.end()));
+            resetChanges();
+        }
+
+
+        void Journal::close()
+        {
+            mModel->mChangedSignal.disconnect(mModelChangedSlot);
+            mModel->mClearedSignal.disconnect(mModelClearedSlot);
+            mModel->mResourceAddedSignal.disconnect(mResourceAddedSlot);
+            mModel->mResourceEditedSignal.disconnect(mResourceEditedSlot);
+            mModel->mResourceRemovedSignal.disconnect(mResourceRemovedSlot);
+            mModel->mResourceRenamedSignal.disconnect(mResourceRenamedSlot);
+            stop();
+
+            // Clean exit, there is nothing to recover next time
+            std::remove(mPath.c_str());
+        }
+
+
+        void Journal::onModelChanged()
+        {
+            mDirty = true;
+            mLastChange = std::chrono::steady_clock::now();
+            update();
+        }
+
+
+        void Journal::onModelCleared()
+        {
+            // The model is replaced as a whole, which is only journaled by a checkpoint
+            mNeedsCheckpoint = true;
+            mTouched.clear();
+            mOperations.clear();
+        }
+
+
+        void Journal::onResourceAdded(const std::string& mID)
+        {
+            mTouched.emplace(mID);
+        }
+
+
+        void Journal::onResourceEdited(const std::string& mID)
+        {
+            mTouched.emplace(mID);
+        }
+
+
+        void Journal::onResourceRemoved(const std::string& mID)
+        {
+            mTouched.erase(mID);
+            mOperations.push_back({ mID, "" });
+        }
+
+
+        void Journal::onResourceRenamed(const std::string& mID, const std::string& newID)
+        {
+            if (newID.empty() || newID == mID)
+                return;
+            mOperations.push_back({ mID, newID });
+            if (mTouched.erase(mID) > 0)
+                mTouched.emplace(newID);
+        }
+
+
+        void Journal::writeDelta()
+        {
+            std::vector<uint8_t> delta;
+            if (!encodeDelta(delta))
+            {
+                // Values without a binary form can only be journaled by a checkpoint
+                mNeedsCheckpoint = true;
+                return;
+            }
+            post(ERecordType::Delta, std::move(delta));
+            mTouched.clear();
+            mOperations.clear();
+            mTreeGeneration = mModel->getTreeGeneration();
+            mDirty = false;
+            mDeltaCount++;
+        }
+
+
+        bool Journal::encodeDelta(std::vector<uint8_t>& output)
+        {
+            // Layout: removals and renames, the added and edited resources, the tree locations when the tree changed
+            writeBinary(output, uint32_t(mOperations.size()));
+            for (auto& operation : mOperations)
+            {
+                writeBinary(output, operation.mID);
+                writeBinary(output, operation.mNewID);
+            }
+
+            std::vector<Resource*> resources;
+            resources.reserve(mTouched.size());
+            for (auto& mID : mTouched)
+            {
+                auto resource = mModel->findResource(mID);
+                if (resource != nullptr)
+                    resources.emplace_back(resource);
+            }
+
+            // Resource layout: mID, type, template link, size of the values, the values of all properties except mID
+            writeBinary(output, uint32_t(resources.size()));
+            for (auto resource : resources)
+            {
+                auto type = resource->get_type();
+                writeBinary(output, resource->mID);
+                writeBinary(output, type.get_name().to_string());
+                auto derivation = mModel->getDerivation(resource->mID);
+                output.push_back(derivation != nullptr ? 1 : 0);
+                if (derivation != nullptr)
+                {
+                    writeBinary(output, derivation->mTemplateID);
+                    writeBinary(output, uint32_t(derivation->mOverrides.size()));
+                    for (auto& name : derivation->mOverrides)
+                        writeBinary(output, name);
+                }
+
+                auto sizePosition = output.size();
+                writeBinary(output, uint32_t(0));
+                for (auto& property : type.get_properties())
+                    if (property.get_name() != "mID" && !writeValue(property.get_value(*resource), output))
+                        return false;
+                auto size = uint32_t(output.size() - sizePosition - sizeof(uint32_t));
+                std::memcpy(&output[sizePosition], &size, sizeof(size));
+            }
+
+            // The tree is journaled as a whole, only by commands that change it
+            bool treeChanged = mModel->getTreeGeneration() != mTreeGeneration;
+            output.push_back(treeChanged ? 1 : 0);
+            if (treeChanged)
+            {
+                std::vector<std::string> mIDs;
+                mIDs.reserve(mModel->getResources().size());
+                for (auto& resource : mModel->getResources())
+                    mIDs.emplace_back(resource->mID);
+                auto locations = mModel->getTreeLocations(mIDs);
+                writeBinary(output, uint32_t(locations.size()));
+                for (auto& location : locations)
+                {
+                    writeBinary(output, location.mID);
+                    writeBinary(output, location.mParentID);
+                    writeBinary(output, uint32_t(location.mIndex));
+                }
+            }
+            return true;
+        }
+
+
+        bool Journal::applyDelta(const std::string& delta, utility::ErrorState& errorState)
+        {
+            auto data = reinterpret_cast<const uint8_t*>(delta.data());
+            auto end = data + delta.size();
+
+            uint32_t count;
+            if (!errorState.check(readBinary(data, end, count), "Invalid journal delta"))
+                return false;
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                std::string mID, newID;
+                if (!errorState.check(readBinary(data, end, mID) && readBinary(data, end, newID), "Invalid journal operation"))
+                    return false;
+                if (mModel->findResource(mID) == nullptr)
+                    continue;
+                if (newID.empty())
+                    mModel->removeResource(mID);
+                else
+                    mModel->renameResource(mID, newID);
+            }
+
+            // Create the resources that do not exist yet before reading any values, so that pointers between them resolve
+            struct Record
+            {
+                Resource* mResource = nullptr;
+                bool mDerived = false;
+                Model::Derivation mDerivation;
+                const uint8_t* mValues = nullptr;
+                const uint8_t* mValuesEnd = nullptr;
+            };
+            std::vector<Record> records;
+            if (!errorState.check(readBinary(data, end, count), "Invalid journal delta"))
+                return false;
+            records.reserve(count);
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                std::string mID, typeName;
+                Record record;
+                uint8_t derived;
+                if (!errorState.check(readBinary(data, end, mID) && readBinary(data, end, typeName) && readBinary(data, end, derived), "Invalid journal resource"))
+                    return false;
+                record.mDerived = derived != 0;
+                if (record.mDerived)
+                {
+                    uint32_t overrides;
+                    if (!errorState.check(readBinary(data, end, record.mDerivation.mTemplateID) && readBinary(data, end, overrides), "Invalid journal template link"))
+                        return false;
+                    for (uint32_t j = 0; j < overrides; ++j)
+                    {
+                        std::string name;
+                        if (!errorState.check(readBinary(data, end, name), "Invalid journal template link"))
+                            return false;
+                        record.mDerivation.mOverrides.emplace(std::move(name));
+                    }
+                }
+                uint32_t size;
+                if (!errorState.check(readBinary(data, end, size) && size_t(end - data) >= size, "Invalid journal resource"))
+                    return false;
+                record.mValues = data;
+                record.mValuesEnd = data + size;
+                data += size;
+
+                auto type = rtti::TypeInfo::get_by_name(typeName);
+                if (!errorState.check(type.is_valid(), "Unknown type in journal: %s", typeName.c_str()))
+                    return false;
+                auto resource = mModel->findResource(mID);
+                if (resource != nullptr && resource->get_type() != type)
+                {
+                    mModel->removeResource(mID);
+                    resource = nullptr;
+                }
+                if (resource == nullptr)
+                {
+                    resource = rtti_cast<Resource>(mModel->getFactory().create(type));
+                    if (!errorState.check(resource != nullptr, "Failed to create %s from journal", typeName.c_str()))
+                        return false;
+                    resource->mID = mID;
+                    mModel->addEmbeddedObject(resource);
+                }
+                record.mResource = resource;
+                records.emplace_back(std::move(record));
+            }
+
+            auto resolve = [this](const std::string& mID) -> rtti::Object* { return mModel->findResource(mID); };
+            for (auto& record : records)
+            {
+                auto position = record.mValues;
+                for (auto& property : record.mResource->get_type().get_properties())
+                {
+                    if (property.get_name() == "mID")
+                        continue;
+                    auto value = property.get_value(*record.mResource);
+                    if (!errorState.check(readValue(position, record.mValuesEnd, value, resolve), "Invalid journal value: %s", record.mResource->mID.c_str()))
+                        return false;
+                    property.set_value(*record.mResource, value);
+                }
+            }
+            for (auto& record : records)
+            {
+                if (record.mDerived)
+                    mModel->restoreDerivations({ { record.mResource->mID, record.mDerivation } });
+                else
+                    mModel->clearTemplate(record.mResource->mID);
+            }
+
+            uint8_t treeChanged;
+            if (!errorState.check(readBinary(data, end, treeChanged), "Invalid journal delta"))
+                return false;
+            if (treeChanged != 0)
+            {
+                if (!errorState.check(readBinary(data, end, count), "Invalid journal tree"))
+                    return false;
+                std::vector<Model::TreeLocation> locations;
+                locations.reserve(count);
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    Model::TreeLocation location;
+                    uint32_t index;
+                    if (!errorState.check(readBinary(data, end, location.mID) && readBinary(data, end, location.mParentID) && readBinary(data, end, index), "Invalid journal tree"))
+                        return false;
+                    location.mIndex = int(index);
+                    if (mModel->findResource(location.mID) != nullptr && (location.mParentID.empty() || mModel->findGroup(location.mParentID) != nullptr))
+                        locations.emplace_back(std::move(location));
+                }
+                mModel->restoreTreeLocations(locations);
+            }
+            return true;
+        }
+
+
+        void Journal::checkpoint()
+        {
+            std::vector<uint8_t> data;
+            utility::ErrorState errorState;
+            if (!mModel->serializeBinary(data, errorState))
+            {
+                // Keep appending deltas to the journal as it is, instead of retrying every frame
+                Logger::error("Failed to write journal checkpoint: %s", errorState.toString().c_str());
+                mNeedsCheckpoint = false;
+                mDeltaCount = 0;
+                return;
+            }
+            post(ERecordType::Checkpoint, std::move(data));
+            resetChanges();
+        }
+
+
+        void Journal::resetChanges()
+        {
+            mTouched.clear();
+            mOperations.clear();
+            mTreeGeneration = mModel->getTreeGeneration();
+            mDirty = false;
+            mNeedsCheckpoint = false;
+            mDeltaCount = 0;
+            mLastChange = std::chrono::steady_clock::now();
+        }
+
+
+        void Journal::post(ERecordType type, std::vector<uint8_t>&& payload)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                // A saved path starts a new journal, a checkpoint replaces the pending deltas and checkpoints
+                if (type == ERecordType::SavedPath)
+                    mJobs.clear();
+                else if (type == ERecordType::Checkpoint)
+                    mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(), [](const Job& job) { return job.mType != ERecordType::SavedPath; }), mJobs.end());
+                mJobs.push_back({ type, std::move(payload) });
+            }
+            mCondition.notify_one();
+        }
+
+
+        bool Journal::readJournal(utility::ErrorState& errorState)
+        {
+            std::ifstream file(mPath, std::ios::binary);
+            if (!file.is_open())
+                return true; // No journal, the previous session exited cleanly
+
+            // Records are read until the end of the file. A record that was cut off by the crash is ignored.
+            while (true)
+            {
+                ERecordType type;
+                uint32_t size;
+                if (!file.read(reinterpret_cast<char*>(&type), sizeof(type)) || !file.read(reinterpret_cast<char*>(&size), sizeof(size)))
+                    break;
+                std::string payload(size, '\0');
+                if (!file.read(&payload[0], size))
+                    break;
+
+                if (type == ERecordType::SavedPath)
+                {
+                    mRecoveredPath = std::move(payload);
+                    mRecoveredCheckpoint.clear();
+                    mRecoveredDeltas.clear();
+                }
+                else if (type == ERecordType::Checkpoint)
+                {
+                    mRecoveredCheckpoint = std::move(payload);
+                    mRecoveredDeltas.clear();
+                }
+                else if (type == ERecordType::Delta)
+                    mRecoveredDeltas.emplace_back(std::move(payload));
+                else
+                    break;
+            }
+
+            mHasRecovery = !mRecoveredPath.empty() || !mRecoveredCheckpoint.empty() || !mRecoveredDeltas.empty();
+            return true;
+        }
+
+
+        void Journal::writeThread()
+        {
+            std::string savedPath;
+            std::ofstream file;
+            std::vector<Job> jobs;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mMutex);
+                    mCondition.wait(lock, [this](){ return mStopping || !mJobs.empty(); });
+                    if (mJobs.empty())
+                        return; // Stopping and all jobs are written
+                    std::swap(jobs, mJobs);
+                }
+
+                // A saved path or checkpoint replaces the journal, deltas are appended to it
+                const Job* checkpoint = nullptr;
+                bool replace = !file.is_open();
+                for (auto& job : jobs)
+                {
+                    if (job.mType == ERecordType::SavedPath)
+                    {
+                        savedPath.assign(job.mPayload.begin(), job.mPayload.end());
+                        checkpoint = nullptr;
+                        replace = true;
+                    }
+                    else if (job.mType == ERecordType::Checkpoint)
+                    {
+                        checkpoint = &job;
+                        replace = true;
+                    }
+                }
+
+                if (replace)
+                {
+                    file.close();
+                    if (!replaceJournal(savedPath, checkpoint))
+                        Logger::error("Failed to write journal: %s", mPath.c_str());
+                    file.open(mPath, std::ios::binary | std::ios::app);
+                }
+                for (auto& job : jobs)
+                    if (job.mType == ERecordType::Delta)
+                        writeRecord(file, uint8_t(job.mType), job.mPayload.data(), uint32_t(job.mPayload.size()));
+                file.flush();
+                if (!file.good())
+                    Logger::error("Failed to append to journal: %s", mPath.c_str());
+                jobs.clear();
+            }
+        }
+
+
+        bool Journal::replaceJournal(const std::string& savedPath, const Job* checkpoint)
+        {
+            auto temporaryPath = mPath + ".tmp";
+            {
+                std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+                writeRecord(file, uint8_t(ERecordType::SavedPath), reinterpret_cast<const uint8_t*>(savedPath.data()), uint32_t(savedPath.size()));
+                if (checkpoint != nullptr)
+                    writeRecord(file, uint8_t(ERecordType::Checkpoint), checkpoint->mPayload.data(), uint32_t(checkpoint->mPayload.size()));
+                file.flush();
+                if (!file.good())
+                    return false;
+            }
+
+            // Replace the journal in one step, so that there is always either the old or the new journal
+#ifdef _WIN32
+            return MoveFileExA(temporaryPath.c_str(), mPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+            return std::rename(temporaryPath.c_str(), mPath.c_str()) == 0;
+#endif
+        }
+
+
+        void Journal::stop()
+        {
+            if (!mThread.joinable())
+                return;
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mStopping = true;
+            }
+            mCondition.notify_one();
+            mThread.join();
+        }
+
+    }
+
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <model.h>
+#include <controller.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace nap
+{
+
+    namespace edit
+    {
+
+        /**
+         * Crash recovery journal for the Model.
+         * The journal file contains the path of the last saved file, optionally followed by a checkpoint of the complete model,
+         * followed by a delta for every command applied after it. A delta only contains the resources the command added, edited,
+         * removed or renamed, so journaling a command costs time proportional to the size of the change, not of the model.
+         * Deltas are appended to the file from a background thread, so that the UI never waits for the disk.
+         * While the Controller runs an edit session nothing is journaled, the whole session becomes one delta when it ends.
+         * Full checkpoints are rare: they replace the journaled deltas when the model has been idle for a while or after a number of commands.
+         * The file is then replaced atomically, so a crash while writing a checkpoint leaves the previous journal intact.
+         * The journal is compacted whenever the model is saved or loaded, and removed by close() when the editor exits cleanly.
+         * When the journal still exists on startup the editor did not exit cleanly and the journal can be recovered.
+         */
+        class NAPAPI Journal : public Resource
+        {
+            RTTI_ENABLE(Resource)
+
+        public:
+            Journal() = default;
+            ~Journal() override;
+
+            ResourcePtr<Model> mModel;                      ///< Property: 'Model' The model that is journaled
+            ResourcePtr<Controller> mController;            ///< Property: 'Controller' The controller that edits the model, edits are journaled when its edit session ends
+            std::string mPath = "napedit.journal";          ///< Property: 'Path' Path of the journal file
+            float mIdleCheckpointDelay = 5.f;               ///< Property: 'IdleCheckpointDelay' Seconds without changes after which the journaled deltas are replaced by a checkpoint
+            int mCheckpointCommands = 500;                  ///< Property: 'CheckpointCommands' Number of journaled deltas after which they are replaced by a checkpoint
+
+            bool init(utility::ErrorState& errorState) override;
+
+            /**
+             * Journals an edit session that ended without changing the model and takes a checkpoint when the model is idle.
+             * Call once per frame.
+             */
+            void update();
+
+            /**
+             * @return True if the previous session did not exit cleanly and left a journal to recover from.
+             */
+            bool hasRecovery() const { return mHasRecovery; }
+
+            /**
+             * Restores the model from the journal of the previous session.
+             * The model is restored from the last checkpoint, or loaded from the last saved file, after which the journaled deltas are applied.
+             * @param savedPath Receives the path of the file the recovered model was last saved to, empty when it was never saved.
+             * @param errorState Contains the error when recovery fails.
+             * @return True on success.
+             */
+            bool recover(std::string& savedPath, utility::ErrorState& errorState);
+
+            /**
+             * Discards all journaled checkpoints and deltas, called after the model was saved to or loaded from path.
+             * @param savedPath Path of the file the model was saved to or loaded from, empty for a new model.
+             */
+            void compact(const std::string& savedPath);
+
+            /**
+             * Writes all pending records and removes the journal, call when the editor exits cleanly.
+             * A journal that is destroyed without being closed is kept, so that it can be recovered.
+             */
+            void close();
+
+        private:
+            enum class ERecordType : uint8_t
+            {
+                SavedPath,      // Path of the last saved file, always the first record
+                Checkpoint,     // Complete model, written by Model::serializeBinary()
+                Delta           // Resources changed by a command, written by writeDelta()
+            };
+
+            // A record that is written to the journal by the writer thread
+            struct Job
+            {
+                ERecordType mType;
+                std::vector<uint8_t> mPayload;
+            };
+
+            // Removals and renames, in the order they happened
+            struct Operation
+            {
+                std::string mID;
+                std::string mNewID;         // Empty for a removal
+            };
+
+            void onModelChanged();
+            Slot<> mModelChangedSlot = { this, &Journal::onModelChanged };
+            void onModelCleared();
+            Slot<> mModelClearedSlot = { this, &Journal::onModelCleared };
+            void onResourceAdded(const std::string& mID);
+            Slot<const std::string&> mResourceAddedSlot = { this, &Journal::onResourceAdded };
+            void onResourceEdited(const std::string& mID);
+            Slot<const std::string&> mResourceEditedSlot = { this, &Journal::onResourceEdited };
+            void onResourceRemoved(const std::string& mID);
+            Slot<const std::string&> mResourceRemovedSlot = { this, &Journal::onResourceRemoved };
+            void onResourceRenamed(const std::string& mID, const std::string& newID);
+            Slot<const std::string&, const std::string&> mResourceRenamedSlot = { this, &Journal::onResourceRenamed };
+
+            void writeDelta();
+            bool encodeDelta(std::vector<uint8_t>& output);
+            bool applyDelta(const std::string& delta, utility::ErrorState& errorState);
+            void checkpoint();
+            void resetChanges();
+            void post(ERecordType type, std::vector<uint8_t>&& payload);
+            bool readJournal(utility::ErrorState& errorState);
+            void writeThread();
+            bool replaceJournal(const std::string& savedPath, const Job* checkpoint);
+            void stop();
+
+            bool mHasRecovery = false;
+            std::string mRecoveredPath;
+            std::string mRecoveredCheckpoint;
+            std::vector<std::string> mRecoveredDeltas;
+
+            // Changes since the last record
+            std::unordered_set<std::string> mTouched;                   // Resources that were added or edited
+            std::vector<Operation> mOperations;                         // Removals and renames
+            uint64_t mTreeGeneration = 0;                               // Tree generation of the model at the last record
+            bool mDirty = false;                                        // The model changed since the last record
+            bool mNeedsCheckpoint = false;                              // The model was replaced, only a checkpoint can journal it
+
+            int mDeltaCount = 0;                                        // Deltas written since the last checkpoint or compaction
+            std::chrono::steady_clock::time_point mLastChange;
+
+            std::thread mThread;
+            std::mutex mMutex;
+            std::condition_variable mCondition;
+            std::vector<Job> mJobs;                                     // Jobs waiting for the writer thread, guarded by mMutex
+            bool mStopping = false;                                     // Guarded by mMutex
+        };
+
+    }
+
+}
@@ -7,8 +7,20 @@
 #include <rtti/jsonwriter.h>
 #include <rtti/defaultlinkresolver.h>
 #include <rtti/jsonreader.h>
+#include <rtti/binarywriter.h>
+#include <rtti/binaryreader.h>
+#include <utility/memorystream.h>
+#include <rapidjson/document.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
 
 #include "nap/logger.h"
+#include "objectutils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::edit::Model)
 	RTTI_CONSTRUCTOR(nap::Core&)
@@ -32,6 +44,16 @@ namespace nap
 		}
 
 
+		namespace
+		{
+			// mID and embedded objects belong to a single resource, they are never shared with a template
+			bool isShared(const rtti::Property& property)
+			{
+				return property.get_name() != "mID" && !rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded);
+			}
+		}
+
+
 		bool Model::init(utility::ErrorState &errorState)
 		{
 			auto groupBase = RTTI_OF(IGroup);
@@ -70,15 +92,536 @@ namespace nap
 			if (!mID.empty())
 			{
 				resource->mID = mID;
-				mResources.emplace_back(std::move(resource));
-				mTree.mResources.emplace_back(mResources.back().get());
-				return mResources.back()->mID;
+				mTree.mResources.emplace_back(addResource(std::move(resource)));
+				return mID;
 			}
 			return "";
 		}
 
 
 
+		void Model::createResources(const rttr::type& type, const std::vector<std::string>& mIDs, const std::string& parentID, const PropertyValues& values)
+		{
+			auto& factory = getFactory();
+			auto group = parentID.empty() ? nullptr : findGroup(parentID);
+			auto entity = parentID.empty() ? nullptr : findResource<Entity>(parentID);
+			bool isGroup = type.is_derived_from(RTTI_OF(IGroup));
+			bool isEntity = type.is_derived_from(RTTI_OF(Entity));
+			bool isComponent = type.is_derived_from(RTTI_OF(Component));
+			assert(!isComponent || entity != nullptr);
+
+			mResources.reserve(mResources.size() + mIDs.size());
+			mResourceIndex.reserve(mResourceIndex.size() + mIDs.size());
+			for (auto& mID : mIDs)
+			{
+				assert(findResource(mID) == nullptr);
+				auto resource = std::unique_ptr<Resource>(rtti_cast<Resource>(factory.create(type)));
+				assert(resource != nullptr);
+				resource->mID = mID;
+				for (auto& value : values)
+					value.first.set_value(*resource, value.second);
+				auto raw = addResource(std::move(resource));
+
+				if (isComponent)
+					entity->mComponents.emplace_back(rtti_cast<Component>(raw));
+				else if (isGroup)
+				{
+					auto newGroup = static_cast<ResourceGroup*>(rtti_cast<IGroup>(raw));
+					if (group != nullptr)
+						group->mChildren.emplace_back(newGroup);
+					else
+						mTree.mGroups.emplace_back(newGroup);
+				}
+				else if (isEntity)
+					mTree.mEntities.emplace_back(static_cast<Entity*>(raw));
+				else if (group != nullptr)
+					group->mMembers.emplace_back(raw);
+				else
+					mTree.mResources.emplace_back(raw);
+			}
+		}
+
+
+		std::vector<std::string> Model::getUniqueIDs(const std::string& aPattern, int count)
+		{
+			auto pattern = utility::replaceAllInstances(utility::trim(aPattern), " ", "_");
+			auto position = pattern.find('#');
+			auto prefix = position == std::string::npos ? pattern : pattern.substr(0, position);
+			auto suffix = position == std::string::npos ? std::string() : pattern.substr(position + 1);
+
+			std::vector<std::string> mIDs;
+			mIDs.reserve(count);
+			int number = 1;
+			while (mIDs.size() < count)
+			{
+				auto mID = prefix + std::to_string(number++) + suffix;
+				if (findResource(mID) == nullptr)
+					mIDs.emplace_back(std::move(mID));
+			}
+			return mIDs;
+		}
+
+
+		std::vector<std::string> Model::duplicateResources(const std::vector<std::string>& mIDs, std::vector<std::string>& copyIDs)
+		{
+			// Gather all objects to copy in a fixed order, so that given copy ids map onto the same objects again
+			std::vector<Resource*> originals;
+			std::unordered_map<rtti::Object*, int> indices;
+			std::unordered_set<Resource*> selected;
+			std::unordered_set<Resource*> nested; // Selected resources that are copied as part of another selected resource
+			for (auto& mID : mIDs)
+			{
+				auto resource = findResource(mID);
+				assert(resource != nullptr);
+				selected.emplace(resource);
+			}
+
+			std::function<void(Resource*, Resource*)> gather = [&](Resource* resource, Resource* root)
+			{
+				if (resource != root && selected.find(resource) != selected.end())
+					nested.emplace(resource);
+				if (!indices.emplace(resource, originals.size()).second)
+					return;
+				originals.emplace_back(resource);
+
+				visitPointers(*resource, [&](const rtti::Path&, int, bool isEmbedded, rtti::Object* target)
+				{
+					if (isEmbedded)
+						gather(findResource(target->mID), root);
+				});
+				auto group = rtti_cast<ResourceGroup>(resource);
+				if (group != nullptr)
+				{
+					for (auto& member : group->mMembers)
+						gather(member.get(), root);
+					for (auto& child : group->mChildren)
+						gather(child.get(), root);
+				}
+				auto entity = rtti_cast<Entity>(resource);
+				if (entity != nullptr)
+				{
+					for (auto& component : entity->mComponents)
+						gather(component.get(), root);
+					for (auto& child : entity->mChildren)
+						gather(child.get(), root);
+				}
+			};
+			for (auto& mID : mIDs)
+			{
+				auto resource = findResource(mID);
+				gather(resource, resource);
+			}
+
+			// Create the copies. Each copy is added right away so that the next generated id takes it into account.
+			bool generateIDs = copyIDs.empty();
+			assert(generateIDs || copyIDs.size() == originals.size());
+			auto& factory = getFactory();
+			std::vector<Resource*> copies;
+			copies.reserve(originals.size());
+			mResources.reserve(mResources.size() + originals.size());
+			mResourceIndex.reserve(mResourceIndex.size() + originals.size());
+			for (auto i = 0; i < originals.size(); ++i)
+			{
+				auto copy = std::unique_ptr<Resource>(rtti_cast<Resource>(factory.create(originals[i]->get_type())));
+				assert(copy != nullptr);
+				if (generateIDs)
+					copyIDs.emplace_back(getUniqueID(originals[i]->mID));
+				copy->mID = copyIDs[i];
+				copies.emplace_back(addResource(std::move(copy)));
+			}
+
+			// Copy the property values and point pointers within the copied set to the copies
+			for (auto i = 0; i < originals.size(); ++i)
+			{
+				auto original = originals[i];
+				auto copy = copies[i];
+				for (auto& property : original->get_type().get_properties())
+					if (property.get_name() != "mID")
+						property.set_value(*copy, property.get_value(*original));
+
+				// Pointers in arrays are grouped per array, visitPointers reports them one array after the other.
+				// Each array is then copied and written once instead of once per pointer.
+				struct Remap
+				{
+					rtti::Path mPath;
+					std::string mKey;                                   // Path of the array, empty for a pointer that is not an array element
+					std::vector<std::pair<int, rtti::Object*>> mTargets;
+				};
+				std::vector<Remap> remaps;
+				visitPointers(*copy, [&](const rtti::Path& path, int arrayIndex, bool, rtti::Object* target)
+				{
+					auto it = indices.find(target);
+					if (it == indices.end())
+						return;
+					auto key = arrayIndex >= 0 ? path.toString() : std::string();
+					if (key.empty() || remaps.empty() || remaps.back().mKey != key)
+						remaps.push_back({ path, key, {} });
+					remaps.back().mTargets.emplace_back(arrayIndex, copies[it->second]);
+				});
+				for (auto& remap : remaps)
+				{
+					if (remap.mKey.empty())
+						setPointer(*copy, remap.mPath, -1, remap.mTargets.front().second);
+					else
+						setPointers(*copy, remap.mPath, remap.mTargets);
+				}
+			}
+
+			// Place the copies of the selected resources next to their originals.
+			// The lookups are built once, so that placing stays linear in the number of copies.
+			std::vector<std::string> rootIDs;
+			std::unordered_set<const Resource*> placed;
+			std::unordered_map<std::string, std::string> parents;
+			for (auto& location : getTreeLocations(mIDs))
+				parents[location.mID] = location.mParentID;
+			std::unordered_map<const Resource*, Entity*> owners; // Entity of every component
+			for (auto& resource : mResources)
+			{
+				auto entity = rtti_cast<Entity>(resource.get());
+				if (entity != nullptr)
+					for (auto& component : entity->mComponents)
+						owners.emplace(component.get(), entity);
+			}
+			for (auto& mID : mIDs)
+			{
+				auto original = findResource(mID);
+				if (nested.find(original) != nested.end())
+					continue;
+				auto copy = copies[indices[original]];
+				if (!placed.emplace(copy).second)
+					continue;
+				rootIDs.emplace_back(copy->mID);
+
+				if (original->get_type().is_derived_from(RTTI_OF(Component)))
+				{
+					auto owner = owners.find(original);
+					if (owner != owners.end())
+						owner->second->mComponents.emplace_back(rtti_cast<Component>(copy));
+					continue;
+				}
+
+				auto parent = parents.find(mID);
+				if (parent == parents.end())
+					continue; // Embedded object, not part of the tree
+				auto group = parent->second.empty() ? nullptr : findGroup(parent->second);
+				auto copyGroup = rtti_cast<ResourceGroup>(copy);
+				if (group == nullptr)
+					insertIntoRoot(*copy, std::numeric_limits<int>::max());
+				else if (copyGroup != nullptr)
+					group->mChildren.emplace_back(copyGroup);
+				else
+					group->mMembers.emplace_back(copy);
+			}
+
+			// Child entities are listed in the root of the tree as well, their copies follow the originals
+			std::unordered_set<const Resource*> rootEntities;
+			for (auto& entity : mTree.mEntities)
+				rootEntities.emplace(entity.get());
+			for (auto i = 0; i < originals.size(); ++i)
+			{
+				auto entity = rtti_cast<Entity>(originals[i]);
+				if (entity == nullptr || placed.find(copies[i]) != placed.end())
+					continue;
+				if (rootEntities.find(entity) != rootEntities.end())
+					mTree.mEntities.emplace_back(static_cast<Entity*>(copies[i]));
+			}
+
+			return rootIDs;
+		}
+
+
+		bool Model::setTemplate(const std::string& mID, const std::string& templateID, const std::unordered_set<std::string>& overrides)
+		{
+			auto resource = findResource(mID);
+			auto source = findResource(templateID);
+			assert(resource != nullptr && source != nullptr);
+			if (resource == source || resource->get_type() != source->get_type())
+				return false;
+
+			// The template may not be derived from the resource itself
+			for (auto derivation = getDerivation(templateID); derivation != nullptr; derivation = getDerivation(derivation->mTemplateID))
+				if (derivation->mTemplateID == mID)
+					return false;
+
+			clearTemplate(mID);
+			mDerivations[mID] = { templateID, overrides };
+			mDependents[templateID].emplace_back(mID);
+
+			std::unordered_set<std::string> applied;
+			applyTemplate(mID, applied);
+			mResourceEditedSignal.trigger(mID);
+			for (auto& property : resource->get_type().get_properties())
+				if (isShared(property) && overrides.find(property.get_name().to_string()) == overrides.end())
+					propagate(*resource, property);
+			return true;
+		}
+
+
+		void Model::clearTemplate(const std::string& mID)
+		{
+			auto derivation = mDerivations.find(mID);
+			if (derivation == mDerivations.end())
+				return;
+
+			auto dependents = mDependents.find(derivation->second.mTemplateID);
+			assert(dependents != mDependents.end());
+			dependents->second.erase(std::remove(dependents->second.begin(), dependents->second.end(), mID), dependents->second.end());
+			if (dependents->second.empty())
+				mDependents.erase(dependents);
+			mDerivations.erase(derivation);
+			mResourceEditedSignal.trigger(mID);
+		}
+
+
+		const Model::Derivation* Model::getDerivation(const std::string& mID) const
+		{
+			auto derivation = mDerivations.find(mID);
+			return derivation != mDerivations.end() ? &derivation->second : nullptr;
+		}
+
+
+		void Model::propertyChanged(const std::string& mID, const std::string& propertyName)
+		{
+			auto resource = findResource(mID);
+			if (resource == nullptr)
+				return;
+
+			// Groups and entities hold the branches of the tree in their properties
+			auto type = resource->get_type();
+			if (type.is_derived_from(RTTI_OF(IGroup)) || type.is_derived_from(RTTI_OF(Entity)))
+				mTreeChanges++;
+			mResourceEditedSignal.trigger(mID);
+
+			if (mDerivations.empty())
+				return;
+			auto property = resource->get_type().get_property(propertyName);
+			if (!property.is_valid() || !isShared(property))
+				return;
+
+			auto derivation = mDerivations.find(mID);
+			if (derivation != mDerivations.end())
+				derivation->second.mOverrides.emplace(propertyName);
+			propagate(*resource, property);
+		}
+
+
+		void Model::revertOverride(const std::string& mID, const std::string& propertyName)
+		{
+			auto derivation = mDerivations.find(mID);
+			assert(derivation != mDerivations.end());
+			derivation->second.mOverrides.erase(propertyName);
+
+			auto resource = findResource(mID);
+			auto source = findResource(derivation->second.mTemplateID);
+			assert(resource != nullptr && source != nullptr);
+			auto property = resource->get_type().get_property(propertyName);
+			assert(property.is_valid());
+			property.set_value(*resource, property.get_value(*source));
+			mResourceEditedSignal.trigger(mID);
+			propagate(*resource, property);
+		}
+
+
+		Model::Derivations Model::getDerivations(const std::vector<std::string>& mIDs) const
+		{
+			Derivations result;
+			if (mDerivations.empty())
+				return result;
+
+			std::unordered_set<std::string> wanted(mIDs.begin(), mIDs.end());
+			for (auto& derivation : mDerivations)
+				if (wanted.find(derivation.first) != wanted.end() || wanted.find(derivation.second.mTemplateID) != wanted.end())
+					result.emplace_back(derivation);
+			return result;
+		}
+
+
+		void Model::restoreDerivations(const Derivations& derivations)
+		{
+			for (auto& derivation : derivations)
+			{
+				if (findResource(derivation.first) == nullptr || findResource(derivation.second.mTemplateID) == nullptr)
+					continue;
+				clearTemplate(derivation.first);
+				mDerivations[derivation.first] = derivation.second;
+				mDependents[derivation.second.mTemplateID].emplace_back(derivation.first);
+			}
+		}
+
+
+		void Model::applyTemplate(const std::string& mID, std::unordered_set<std::string>& applied)
+		{
+			if (!applied.emplace(mID).second)
+				return;
+			auto derivation = mDerivations.find(mID);
+			if (derivation == mDerivations.end())
+				return;
+			auto resource = findResource(mID);
+			auto source = findResource(derivation->second.mTemplateID);
+			if (resource == nullptr || source == nullptr)
+				return;
+
+			// A template can be derived itself, its values need to be resolved first
+			applyTemplate(source->mID, applied);
+
+			auto& overrides = derivation->second.mOverrides;
+			for (auto& property : resource->get_type().get_properties())
+				if (isShared(property) && overrides.find(property.get_name().to_string()) == overrides.end())
+					property.set_value(*resource, property.get_value(*source));
+		}
+
+
+		void Model::propagate(Resource& resource, const rtti::Property& property)
+		{
+			auto dependents = mDependents.find(resource.mID);
+			if (dependents == mDependents.end())
+				return;
+
+			auto value = property.get_value(resource);
+			auto name = property.get_name().to_string();
+			for (auto& mID : dependents->second)
+			{
+				auto& overrides = mDerivations[mID].mOverrides;
+				if (overrides.find(name) != overrides.end())
+					continue;
+				auto dependent = findResource(mID);
+				assert(dependent != nullptr);
+				property.set_value(*dependent, value);
+				mResourceEditedSignal.trigger(mID);
+				propagate(*dependent, property);
+			}
+		}
+
+
+		void Model::removeDerivation(const std::string& mID)
+		{
+			if (mDerivations.empty())
+				return;
+
+			clearTemplate(mID);
+			auto dependents = mDependents.find(mID);
+			if (dependents != mDependents.end())
+			{
+				for (auto& dependent : dependents->second)
+					mDerivations.erase(dependent);
+				mDependents.erase(dependents);
+			}
+		}
+
+
+		bool Model::writeDerivations(std::string& json, utility::ErrorState& errorState)
+		{
+			rapidjson::Document document;
+			document.Parse(json.c_str());
+			if (!errorState.check(!document.HasParseError() && document.IsObject(), "Failed to parse serialized model"))
+				return false;
+
+			// Derived resources can be nested in groups, so every object in the document is visited
+			std::function<void(rapidjson::Value&)> strip = [&](rapidjson::Value& value)
+			{
+				if (value.IsArray())
+				{
+					for (auto& element : value.GetArray())
+						strip(element);
+					return;
+				}
+				if (!value.IsObject())
+					return;
+
+				auto id = value.FindMember("mID");
+				if (id != value.MemberEnd() && id->value.IsString())
+				{
+					auto derivation = mDerivations.find(id->value.GetString());
+					auto resource = derivation != mDerivations.end() ? findResource(derivation->first) : nullptr;
+					if (resource != nullptr)
+					{
+						auto& overrides = derivation->second.mOverrides;
+						for (auto& property : resource->get_type().get_properties())
+						{
+							// Required properties are kept, the reader fails on a missing required property before the templates are applied
+							auto name = property.get_name().to_string();
+							if (isShared(property) && !rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Required) && overrides.find(name) == overrides.end())
+								value.RemoveMember(name.c_str());
+						}
+					}
+				}
+				for (auto& member : value.GetObject())
+					strip(member.value);
+			};
+			strip(document);
+
+			// Template links are written in a fixed order, so that saving the same model twice results in the same file
+			std::vector<std::string> derived;
+			derived.reserve(mDerivations.size());
+			for (auto& derivation : mDerivations)
+				derived.emplace_back(derivation.first);
+			std::sort(derived.begin(), derived.end());
+
+			auto& allocator = document.GetAllocator();
+			rapidjson::Value templates(rapidjson::kArrayType);
+			for (auto& mID : derived)
+			{
+				auto& derivation = mDerivations[mID];
+				std::vector<std::string> names(derivation.mOverrides.begin(), derivation.mOverrides.end());
+				std::sort(names.begin(), names.end());
+				rapidjson::Value overrides(rapidjson::kArrayType);
+				for (auto& name : names)
+					overrides.PushBack(rapidjson::Value(name.c_str(), allocator), allocator);
+
+				rapidjson::Value entry(rapidjson::kObjectType);
+				entry.AddMember("Resource", rapidjson::Value(mID.c_str(), allocator), allocator);
+				entry.AddMember("Template", rapidjson::Value(derivation.mTemplateID.c_str(), allocator), allocator);
+				entry.AddMember("Overrides", overrides, allocator);
+				templates.PushBack(entry, allocator);
+			}
+			document.AddMember("Templates", templates, allocator);
+
+			rapidjson::StringBuffer buffer;
+			rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+			document.Accept(writer);
+			json = buffer.GetString();
+			return true;
+		}
+
+
+		bool Model::readDerivations(const std::string& json, Derivations& derivations, utility::ErrorState& errorState)
+		{
+			// Files without templates are not parsed a second time
+			if (json.find("\"Templates\"") == std::string::npos)
+				return true;
+
+			rapidjson::Document document;
+			document.Parse(json.c_str());
+			if (!errorState.check(!document.HasParseError() && document.IsObject(), "Failed to parse templates"))
+				return false;
+			auto templates = document.FindMember("Templates");
+			if (templates == document.MemberEnd())
+				return true;
+			if (!errorState.check(templates->value.IsArray(), "Templates is not an array"))
+				return false;
+
+			for (auto& entry : templates->value.GetArray())
+			{
+				if (!errorState.check(entry.IsObject(), "Invalid template link"))
+					return false;
+				auto resource = entry.FindMember("Resource");
+				auto source = entry.FindMember("Template");
+				if (!errorState.check(resource != entry.MemberEnd() && resource->value.IsString() && source != entry.MemberEnd() && source->value.IsString(), "Template link without Resource or Template"))
+					return false;
+
+				Derivation derivation;
+				derivation.mTemplateID = source->value.GetString();
+				auto overrides = entry.FindMember("Overrides");
+				if (overrides != entry.MemberEnd() && overrides->value.IsArray())
+					for (auto& name : overrides->value.GetArray())
+						if (name.IsString())
+							derivation.mOverrides.emplace(name.GetString());
+				derivations.emplace_back(resource->value.GetString(), std::move(derivation));
+			}
+			return true;
+		}
+
+
 		std::string Model::createGroup(const rttr::type &groupType, const std::string &aID)
 		{
 			// Create the group
@@ -98,7 +641,7 @@ namespace nap
 			{
 				// Add to mResources and to mTree
 				groupPtr->mID = mID;
-				mResources.emplace_back(std::move(groupPtr));
+				addResource(std::move(groupPtr));
 				mTree.mGroups.emplace_back(static_cast<ResourceGroup*>(group));
 				return mID;
 			}
@@ -118,8 +661,8 @@ namespace nap
 
 			auto entity = std::make_unique<Entity>();
 			entity->mID = mID;
-			mResources.emplace_back(std::move(entity));
-			mTree.mEntities.emplace_back(dynamic_cast<Entity*>(mResources.back().get()));
+			mTree.mEntities.emplace_back(entity.get());
+			addResource(std::move(entity));
 			return mID;
 		}
 
@@ -143,7 +686,8 @@ namespace nap
 			{
 				componentPtr->mID = mID;
 				entity->mComponents.emplace_back(rtti_cast<Component>(componentPtr.get()));
-				mResources.emplace_back(std::move(componentPtr));
+				addResource(std::move(componentPtr));
+				mResourceEditedSignal.trigger(entityID);
 				return mID;
 			}
 			return "";
@@ -164,8 +708,7 @@ namespace nap
 			if (!mID.empty())
 			{
 				resource->mID = mID;
-				mResources.emplace_back(std::move(resource));
-				return mResources.back().get();
+				return addResource(std::move(resource));
 			}
 			return nullptr;
 		}
@@ -181,11 +724,16 @@ namespace nap
 			bool found = eraseFromTree(*resource);
 			assert(found == false);
 
+			// Notify listeners before the resource leaves the model, the caller takes ownership
+			mResourceRemovedSignal.trigger(mID);
+
 			// Save the resource to return it
 			auto result = std::move(*it);
 
 			// Remove from the owned resources list
 			mResources.erase(it);
+			mResourceIndex.erase(mID);
+			mStructureGeneration++;
 
 			return result;
 		}
@@ -193,14 +741,14 @@ namespace nap
 
 		void Model::addEmbeddedObject(Resource *resource)
 		{
-			auto it = std::find_if(mResources.begin(), mResources.end(), [&resource](const auto& element) { return resource->mID == element->mID; });
-			assert(it == mResources.end());
-			mResources.emplace_back(std::unique_ptr<Resource>(resource));
+			assert(findResource(resource->mID) == nullptr);
+			addResource(std::unique_ptr<Resource>(resource));
 		}
 
 
 		void Model::moveResourceToGroup(const std::string &mID, const std::string &groupID)
 		{
+			mTreeChanges++;
 			auto resource = findResource(mID);
 			assert(resource != nullptr);
 			bool found = eraseFromTree(*resource);
@@ -215,6 +763,7 @@ namespace nap
 
 		void Model::moveGroupToParent(const std::string &groupID, const std::string &parentGroupID)
 		{
+			mTreeChanges++;
 			auto group = findGroup(groupID);
 			assert(group != nullptr);
 			auto found = eraseFromTree(*group);
@@ -231,18 +780,21 @@ namespace nap
 
 		void Model::addEntityToParent(const std::string &entityID, const std::string &parentID)
 		{
+			mTreeChanges++;
 			auto entity = findResource<Entity>(entityID);
 			assert(entity != nullptr);
 			auto parent = findResource<Entity>(parentID);
 			if (parent != nullptr)
 			{
 				parent->mChildren.emplace_back(entity);
+				mResourceEditedSignal.trigger(parentID);
 			}
 		}
 
 
 		void Model::removeEntityFromParent(const std::string &entityID, const std::string &parentID)
 		{
+			mTreeChanges++;
 			auto entity = findResource<Entity>(entityID);
 			assert(entity != nullptr);
 			auto parent = findResource<Entity>(parentID);
@@ -251,7 +803,10 @@ namespace nap
 			{
 				auto it = std::find_if(parent->mChildren.begin(), parent->mChildren.end(), [&](auto& child){ return child->mID == entityID; });
 				if (it != parent->mChildren.end())
+				{
 					parent->mChildren.erase(it);
+					mResourceEditedSignal.trigger(parentID);
+				}
 			}
 		}
 
@@ -259,9 +814,8 @@ namespace nap
 		void Model::removeResource(const std::string &mID)
 		{
 			// Find the resource to remove
-			auto it = std::find_if(mResources.begin(), mResources.end(), [&mID](const auto& resource) { return resource->mID == mID; });
-			assert(it != mResources.end());
-			auto resource = it->get();
+			auto resource = findResource(mID);
+			assert(resource != nullptr);
 
 			// Erase it from the tree
 			eraseFromTree(*resource);
@@ -306,8 +860,164 @@ namespace nap
 			// Emit the signal to notify the Selector
 			mResourceRemovedSignal.trigger(mID);
 
-			// Finally remove the resource itself
+			// Finally remove the resource itself. Look it up again, removing the embedded objects invalidated iterators into mResources.
+			auto it = std::find_if(mResources.begin(), mResources.end(), [resource](const auto& element) { return element.get() == resource; });
+			assert(it != mResources.end());
+			removeDerivation(mID);
+			mResourceIndex.erase(mID);
 			mResources.erase(it);
+			mStructureGeneration++;
+		}
+
+
+		void Model::removeResources(const std::vector<std::string>& mIDs)
+		{
+			// Gather the resources with all their embedded objects
+			std::unordered_set<Object*> roots;
+			std::unordered_set<Resource*> removed;
+			for (auto& mID : mIDs)
+			{
+				auto resource = findResource(mID);
+				assert(resource != nullptr);
+				roots.emplace(resource);
+				collectEmbeddedObjects(*resource, removed);
+			}
+
+			// One pass over the tree for all resources
+			eraseFromTree(roots);
+
+			for (auto resource : removed)
+			{
+				mResourceRemovedSignal.trigger(resource->mID);
+				mResourceIndex.erase(resource->mID);
+				removeDerivation(resource->mID);
+			}
+
+			// One pass over the owned resources
+			mResources.erase(std::remove_if(mResources.begin(), mResources.end(), [&removed](const auto& resource)
+			{
+				return removed.find(resource.get()) != removed.end();
+			}), mResources.end());
+			mStructureGeneration++;
+		}
+
+
+		std::vector<Model::TreeLocation> Model::getTreeLocations(const std::vector<std::string>& mIDs)
+		{
+			std::unordered_set<std::string> wanted(mIDs.begin(), mIDs.end());
+			std::vector<TreeLocation> locations;
+
+			std::function<void(const std::vector<ResourcePtr<Resource>>&, const std::string&)> visitMembers;
+			std::function<void(const std::vector<ResourcePtr<ResourceGroup>>&, const std::string&)> visitGroups;
+			auto visit = [&](const auto& branch, const std::string& parentID)
+			{
+				for (auto i = 0; i < branch.size(); ++i)
+					if (wanted.find(branch[i]->mID) != wanted.end())
+						locations.push_back({ branch[i]->mID, parentID, i });
+			};
+			visitMembers = [&](const std::vector<ResourcePtr<Resource>>& branch, const std::string& parentID)
+			{
+				visit(branch, parentID);
+				for (auto& element : branch)
+				{
+					auto group = rtti_cast<ResourceGroup>(element.get());
+					if (group != nullptr)
+					{
+						visitMembers(group->mMembers, group->mID);
+						visitGroups(group->mChildren, group->mID);
+					}
+				}
+			};
+			visitGroups = [&](const std::vector<ResourcePtr<ResourceGroup>>& branch, const std::string& parentID)
+			{
+				visit(branch, parentID);
+				for (auto& group : branch)
+				{
+					visitMembers(group->mMembers, group->mID);
+					visitGroups(group->mChildren, group->mID);
+				}
+			};
+
+			visitMembers(mTree.mResources, "");
+			visitGroups(mTree.mGroups, "");
+			visit(mTree.mEntities, "");
+			return locations;
+		}
+
+
+		void Model::moveResources(const std::vector<std::string>& mIDs, const std::string& groupID)
+		{
+			mTreeChanges++;
+			auto target = groupID.empty() ? nullptr : findGroup(groupID);
+			assert(groupID.empty() || target != nullptr);
+
+			std::vector<Resource*> moved;
+			std::unordered_set<Object*> objects;
+			for (auto& mID : mIDs)
+			{
+				auto resource = findResource(mID);
+				assert(resource != nullptr);
+				auto type = resource->get_type();
+				if (type.is_derived_from(RTTI_OF(Entity)) || type.is_derived_from(RTTI_OF(Component)))
+					continue;
+				// A group can not be moved into itself or into one of its descendants
+				auto group = rtti_cast<ResourceGroup>(resource);
+				if (group != nullptr && target != nullptr && containsGroup(*group, *target))
+					continue;
+				if (objects.emplace(resource).second)
+					moved.emplace_back(resource);
+			}
+			if (moved.empty())
+				return;
+
+			eraseFromTree(objects);
+			for (auto resource : moved)
+			{
+				auto group = rtti_cast<ResourceGroup>(resource);
+				if (target == nullptr)
+					insertIntoRoot(*resource, std::numeric_limits<int>::max());
+				else if (group != nullptr)
+					target->mChildren.emplace_back(group);
+				else
+					target->mMembers.emplace_back(resource);
+			}
+		}
+
+
+		void Model::restoreTreeLocations(const std::vector<TreeLocation>& locations)
+		{
+			mTreeChanges++;
+			std::unordered_set<Object*> objects;
+			for (auto& location : locations)
+				objects.emplace(findResource(location.mID));
+			eraseFromTree(objects);
+
+			// Insert in order of ascending index within each parent, so that every index refers to the branch as it was
+			auto sorted = locations;
+			std::stable_sort(sorted.begin(), sorted.end(), [](const TreeLocation& a, const TreeLocation& b) { return a.mIndex < b.mIndex; });
+			for (auto& location : sorted)
+			{
+				auto resource = findResource(location.mID);
+				assert(resource != nullptr);
+				if (location.mParentID.empty())
+				{
+					insertIntoRoot(*resource, location.mIndex);
+					continue;
+				}
+
+				auto parent = findGroup(location.mParentID);
+				assert(parent != nullptr);
+				auto group = rtti_cast<ResourceGroup>(resource);
+				auto insert = [&location](auto& branch, auto* element)
+				{
+					auto position = std::min<size_t>(std::max(location.mIndex, 0), branch.size());
+					branch.emplace(branch.begin() + position, element);
+				};
+				if (group != nullptr)
+					insert(parent->mChildren, group);
+				else
+					insert(parent->mMembers, resource);
+			}
 		}
 
 
@@ -317,18 +1027,95 @@ namespace nap
 			assert(resource != nullptr);
 			auto newName = getUniqueID(aNewName);
 			if (!newName.empty())
+			{
+				mResourceIndex.erase(mID);
 				resource->mID = newName;
+				mResourceIndex[newName] = resource;
+				mStructureGeneration++;
+
+				// Keep the template links pointing at the resource
+				auto derivation = mDerivations.find(mID);
+				if (derivation != mDerivations.end())
+				{
+					auto link = std::move(derivation->second);
+					mDerivations.erase(derivation);
+					auto& siblings = mDependents[link.mTemplateID];
+					std::replace(siblings.begin(), siblings.end(), mID, newName);
+					mDerivations.emplace(newName, std::move(link));
+				}
+				auto dependents = mDependents.find(mID);
+				if (dependents != mDependents.end())
+				{
+					auto derived = std::move(dependents->second);
+					mDependents.erase(dependents);
+					for (auto& dependent : derived)
+						mDerivations[dependent].mTemplateID = newName;
+					mDependents.emplace(newName, std::move(derived));
+				}
+			}
 
 			// Emit the signal to notify the Selector
 			mResourceRenamedSignal.trigger(mID, newName);
 		}
 
 
+		Resource* Model::addResource(std::unique_ptr<Resource> resource)
+		{
+			auto result = resource.get();
+			mResourceIndex[result->mID] = result;
+			mResources.emplace_back(std::move(resource));
+			mStructureGeneration++;
+			mResourceAddedSignal.trigger(result->mID);
+			return result;
+		}
+
+
+		int Model::getRootIndex(const Resource &resource)
+		{
+			auto indexOf = [&resource](const auto& branch)
+			{
+				auto it = std::find_if(branch.begin(), branch.end(), [&resource](const auto& element) { return element.get() == &resource; });
+				return it == branch.end() ? -1 : int(it - branch.begin());
+			};
+
+			if (resource.get_type().is_derived_from(RTTI_OF(IGroup)))
+				return indexOf(mTree.mGroups);
+			else if (resource.get_type().is_derived_from(RTTI_OF(Entity)))
+				return indexOf(mTree.mEntities);
+			else
+				return indexOf(mTree.mResources);
+		}
+
+
+		void Model::insertIntoRoot(Resource &resource, int index)
+		{
+			mTreeChanges++;
+			auto insert = [index](auto& branch, auto* element)
+			{
+				auto position = std::min<size_t>(std::max(index, 0), branch.size());
+				branch.emplace(branch.begin() + position, element);
+			};
+
+			if (resource.get_type().is_derived_from(RTTI_OF(IGroup)))
+				insert(mTree.mGroups, static_cast<ResourceGroup*>(rtti_cast<IGroup>(&resource)));
+			else if (resource.get_type().is_derived_from(RTTI_OF(Entity)))
+				insert(mTree.mEntities, static_cast<Entity*>(&resource));
+			else
+				insert(mTree.mResources, &resource);
+		}
+
+
+		rtti::Factory& Model::getFactory()
+		{
+			return mCore.getResourceManager()->getFactory();
+		}
+
+
 		Resource* Model::findResource(const std::string &mID)
 		{
-			auto it = std::find_if(mResources.begin(), mResources.end(), [&mID](const auto& resource) { return resource->mID == mID; });
-			if (it != mResources.end())
-				return it->get();
+			auto it = mResourceIndex.find(mID);
+			if (it != mResourceIndex.end())
+				return it->second;
 
 			return nullptr;
 		}
@@ -349,40 +1136,161 @@ namespace nap
 		void Model::clear()
 		{
 			mResources.clear();
+			mResourceIndex.clear();
+			mDerivations.clear();
+			mDependents.clear();
+			mStructureGeneration++;
 			mTree.mResources.clear();
 			mTree.mGroups.clear();
 			mTree.mEntities.clear();
 			mClearedSignal.trigger();
+			notifyChanged();
 		}
 
 
-		bool Model::serialize(std::string &output, utility::ErrorState &errorState)
+		std::vector<rtti::Object*> Model::getRootObjects() const
 		{
-			std::vector<Object*> objects;
+			std::vector<rtti::Object*> objects;
+			objects.reserve(mTree.mGroups.size() + mTree.mResources.size() + mTree.mEntities.size());
 			for (auto& resource : mTree.mGroups)
 				objects.emplace_back(resource.get());
 			for (auto& resource : mTree.mResources)
 				objects.emplace_back(resource.get());
 			for (auto& resource : mTree.mEntities)
 				objects.emplace_back(resource.get());
+			return objects;
+		}
+
 
+		bool Model::serialize(std::string &output, utility::ErrorState &errorState)
+		{
 			rtti::JSONWriter writer;
-			if (serializeObjects(objects, writer, errorState))
+			if (!serializeObjects(getRootObjects(), writer, errorState))
+				return false;
+
+			// Derived resources are written as a reference to their template plus their overrides
+			output = writer.GetJSON();
+			if (!mDerivations.empty())
+				return writeDerivations(output, errorState);
+			return true;
+		}
+
+
+		bool Model::deserialize(const std::string &input, utility::ErrorState &errorState)
+		{
+			rtti::DeserializeResult result;
+			if (!rtti::deserializeJSON(input, rtti::EPropertyValidationMode::AllowMissingProperties, rtti::EPointerPropertyMode::NoRawPointers, mCore.getResourceManager()->getFactory(), result, errorState))
+				return false;
+
+			Derivations derivations;
+			if (!readDerivations(input, derivations, errorState))
+				return false;
+			return load(result, derivations, errorState);
+		}
+
+
+		namespace
+		{
+			// Length prefixed strings and counts following the objects in the binary format
+			void writeBinary(std::vector<uint8_t>& output, uint32_t value)
+			{
+				auto bytes = reinterpret_cast<const uint8_t*>(&value);
+				output.insert(output.end(), bytes, bytes + sizeof(value));
+			}
+
+			void writeBinary(std::vector<uint8_t>& output, const std::string& value)
+			{
+				writeBinary(output, uint32_t(value.size()));
+				output.insert(output.end(), value.begin(), value.end());
+			}
+
+			// Reading advances data, fails when the value does not fit before end
+			bool readBinary(const uint8_t*& data, const uint8_t* end, uint32_t& value)
 			{
-				output = writer.GetJSON();
+				if (size_t(end - data) < sizeof(value))
+					return false;
+				std::memcpy(&value, data, sizeof(value));
+				data += sizeof(value);
 				return true;
 			}
-			else
+
+			bool readBinary(const uint8_t*& data, const uint8_t* end, std::string& value)
+			{
+				uint32_t size;
+				if (!readBinary(data, end, size) || size_t(end - data) < size)
+					return false;
+				value.assign(reinterpret_cast<const char*>(data), size);
+				data += size;
+				return true;
+			}
+		}
+
+
+		bool Model::serializeBinary(std::vector<uint8_t>& output, utility::ErrorState& errorState)
+		{
+			// Layout: size of the objects, the objects, the template links
+			rtti::BinaryWriter writer;
+			if (!serializeObjects(getRootObjects(), writer, errorState))
 				return false;
+			auto& objects = writer.getBuffer();
+			output.clear();
+			output.reserve(sizeof(uint32_t) + objects.size());
+			writeBinary(output, uint32_t(objects.size()));
+			output.insert(output.end(), objects.begin(), objects.end());
+
+			// Derived resources are written in full, the template links only restore the overrides
+			writeBinary(output, uint32_t(mDerivations.size()));
+			for (auto& derivation : mDerivations)
+			{
+				writeBinary(output, derivation.first);
+				writeBinary(output, derivation.second.mTemplateID);
+				writeBinary(output, uint32_t(derivation.second.mOverrides.size()));
+				for (auto& name : derivation.second.mOverrides)
+					writeBinary(output, name);
+			}
+			return true;
 		}
 
 
-		bool Model::deserialize(const std::string &input, utility::ErrorState &errorState)
+		bool Model::deserializeBinary(const uint8_t* data, size_t size, utility::ErrorState& errorState)
 		{
+			auto end = data + size;
+			uint32_t objectsSize;
+			if (!errorState.check(readBinary(data, end, objectsSize) && size_t(end - data) >= objectsSize, "Invalid binary model"))
+				return false;
+
 			rtti::DeserializeResult result;
-			if (!rtti::deserializeJSON(input, rtti::EPropertyValidationMode::AllowMissingProperties, rtti::EPointerPropertyMode::NoRawPointers, mCore.getResourceManager()->getFactory(), result, errorState))
+			MemoryStream objects(data, objectsSize);
+			if (!rtti::deserializeBinary(objects, mCore.getResourceManager()->getFactory(), result, errorState))
+				return false;
+			data += objectsSize;
+
+			Derivations derivations;
+			uint32_t count;
+			if (!errorState.check(readBinary(data, end, count), "Invalid template links"))
 				return false;
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				std::string mID;
+				Derivation derivation;
+				uint32_t overrides;
+				if (!errorState.check(readBinary(data, end, mID) && readBinary(data, end, derivation.mTemplateID) && readBinary(data, end, overrides), "Invalid template link"))
+					return false;
+				for (uint32_t j = 0; j < overrides; ++j)
+				{
+					std::string name;
+					if (!errorState.check(readBinary(data, end, name), "Invalid template link"))
+						return false;
+					derivation.mOverrides.emplace(std::move(name));
+				}
+				derivations.emplace_back(std::move(mID), std::move(derivation));
+			}
+			return load(result, derivations, errorState);
+		}
 
+
+		bool Model::load(rtti::DeserializeResult& result, const Derivations& derivations, utility::ErrorState& errorState)
+		{
 			if (!rtti::DefaultLinkResolver::sResolveLinks(result.mReadObjects, result.mUnresolvedPointers, errorState))
 			{
 				errorState.fail("Failed to resolve links.");
@@ -395,7 +1303,7 @@ namespace nap
 			for (auto& object : result.mReadObjects)
 			{
 				auto raw = dynamic_cast<Resource*>(object.release());
-				mResources.emplace_back(std::move(std::unique_ptr<Resource>(raw)));
+				addResource(std::unique_ptr<Resource>(raw));
 			}
 
 			// Populate the roots of the tree
@@ -464,6 +1372,13 @@ namespace nap
 				}
 			}
 
+			// Properties that are not overridden were not written for derived resources, they are resolved from the templates
+			restoreDerivations(derivations);
+			std::unordered_set<std::string> applied;
+			for (auto& derivation : derivations)
+				applyTemplate(derivation.first, applied);
+
+			notifyChanged();
 			return true;
 		}
 
@@ -495,6 +1410,34 @@ namespace nap
 		}
 
 
+		void Model::notifyChanged()
+		{
+			mGeneration++;
+			if (mDeferredNotifications > 0)
+				mChangePending = true;
+			else
+				mChangedSignal.trigger();
+		}
+
+
+		void Model::deferNotifications()
+		{
+			mDeferredNotifications++;
+		}
+
+
+		void Model::resumeNotifications()
+		{
+			assert(mDeferredNotifications > 0);
+			mDeferredNotifications--;
+			if (mDeferredNotifications == 0 && mChangePending)
+			{
+				mChangePending = false;
+				mChangedSignal.trigger();
+			}
+		}
+
+
 		bool Model::eraseFromTree(std::vector<ResourcePtr<Resource>>& branch, Object &object)
 		{;
 			auto it = std::find(branch.begin(), branch.end(), &object);
@@ -568,6 +1511,110 @@ namespace nap
 		}
 
 
+		void Model::eraseFromTree(const std::unordered_set<Object*>& objects)
+		{
+			auto erase = [&objects](auto& branch)
+			{
+				branch.erase(std::remove_if(branch.begin(), branch.end(), [&objects](const auto& element)
+				{
+					return objects.find(element.get()) != objects.end();
+				}), branch.end());
+			};
+
+			std::function<void(std::vector<ResourcePtr<Resource>>&)> eraseMembers;
+			std::function<void(std::vector<ResourcePtr<ResourceGroup>>&)> eraseGroups;
+			eraseMembers = [&](std::vector<ResourcePtr<Resource>>& branch)
+			{
+				erase(branch);
+				for (auto& element : branch)
+				{
+					auto group = rtti_cast<ResourceGroup>(element.get());
+					if (group != nullptr)
+					{
+						eraseMembers(group->mMembers);
+						eraseGroups(group->mChildren);
+					}
+				}
+			};
+			eraseGroups = [&](std::vector<ResourcePtr<ResourceGroup>>& branch)
+			{
+				erase(branch);
+				for (auto& group : branch)
+				{
+					eraseMembers(group->mMembers);
+					eraseGroups(group->mChildren);
+				}
+			};
+
+			std::function<void(std::vector<ResourcePtr<Entity>>&)> eraseEntities;
+			eraseEntities = [&](std::vector<ResourcePtr<Entity>>& branch)
+			{
+				erase(branch);
+				for (auto& entity : branch)
+				{
+					erase(entity->mComponents);
+					eraseEntities(entity->mChildren);
+				}
+			};
+
+			eraseMembers(mTree.mResources);
+			eraseGroups(mTree.mGroups);
+			eraseEntities(mTree.mEntities);
+		}
+
+
+		void Model::collectEmbeddedObjects(Resource& resource, std::unordered_set<Resource*>& objects)
+		{
+			if (!objects.emplace(&resource).second)
+				return;
+
+			for (auto& property : resource.get_type().get_properties())
+			{
+				if (!rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded))
+					continue;
+
+				auto propertyValue = property.get_value(resource);
+				auto propertyType = property.get_type();
+				auto collect = [&](const rtti::Variant& value)
+				{
+					rtti::Object* embeddedObject = value.get_value<rtti::ObjectPtr<rtti::Object>>().get();
+					if (embeddedObject != nullptr)
+						collectEmbeddedObjects(*findResource(embeddedObject->mID), objects);
+				};
+
+				if (propertyType.is_derived_from<rtti::ObjectPtrBase>())
+					collect(propertyValue);
+				else if (propertyType.is_array())
+				{
+					auto array = propertyValue.create_array_view();
+					for (auto i = 0; i < array.get_size(); ++i)
+					{
+						auto element = array.get_value(i);
+						if (element.get_type().is_derived_from<rtti::ObjectPtrBase>())
+							collect(element);
+					}
+				}
+			}
+		}
+
+
+		bool Model::containsGroup(ResourceGroup& group, const ResourceGroup& other)
+		{
+			if (&group == &other)
+				return true;
+			for (auto& child : group.mChildren)
+				if (containsGroup(*child, other))
+					return true;
+			for (auto& member : group.mMembers)
+			{
+				auto memberGroup = rtti_cast<ResourceGroup>(member.get());
+				if (memberGroup != nullptr && containsGroup(*memberGroup, other))
+					return true;
+			}
+			return false;
+		}
+
+
 		std::string Model::getUniqueID(const std::string &aBaseID)
 		{
 			auto baseID = aBaseID;
@@ -615,17 +1662,83 @@ namespace nap
 		}
 
 
-		void Selector::onResourceRemoved(const std::string &mID)
+		void Selector::set(const std::string& mID)
 		{
+			assert(mModel->findResource(mID) != nullptr);
+			if (mSelected.size() == 1 && mSelection == mID)
+				return;
+			clear();
+			add(mID);
+		}
+
+
+		void Selector::add(const std::string& mID)
+		{
+			assert(mModel->findResource(mID) != nullptr);
+			if (mIndex.emplace(mID, mSelected.size()).second)
+				mSelected.emplace_back(mID);
+			mSelection = mID;
+			mVersion++;
+		}
+
+
+		void Selector::remove(const std::string& mID)
+		{
+			auto it = mIndex.find(mID);
+			if (it == mIndex.end())
+				return;
+
+			// Erase in place to keep the selection order, only the positions after it shift
+			auto position = it->second;
+			mIndex.erase(it);
+			mSelected.erase(mSelected.begin() + position);
+			for (auto i = position; i < mSelected.size(); ++i)
+				mIndex[mSelected[i]] = i;
+
 			if (mSelection == mID)
-				mSelection.clear();
+				mSelection = mSelected.empty() ? std::string() : mSelected.back();
+			mVersion++;
+		}
+
+
+		void Selector::toggle(const std::string& mID)
+		{
+			if (contains(mID))
+				remove(mID);
+			else
+				add(mID);
+		}
+
+
+		void Selector::clear()
+		{
+			if (mSelected.empty())
+				return;
+			mSelection.clear();
+			mSelected.clear();
+			mIndex.clear();
+			mVersion++;
+		}
+
+
+		void Selector::onResourceRemoved(const std::string &mID)
+		{
+			remove(mID);
 		}
 
 
 		void Selector::onResourceRenamed(const std::string& oldID, const std::string& newID)
 		{
+			auto it = mIndex.find(oldID);
+			if (it == mIndex.end())
+				return;
+			auto position = it->second;
+			mIndex.erase(it);
+			mIndex[newID] = position;
+			mSelected[position] = newID;
 			if (mSelection == oldID)
 				mSelection = newID;
+			mVersion++;
 		}
 
 	}
@@ -5,6 +5,10 @@
 
 #include <entity.h>
 #include <nap/group.h>
+#include <rtti/deserializeresult.h>
+
+#include <unordered_map>
+#include <unordered_set>
 
 namespace nap
 {
@@ -47,6 +51,108 @@ namespace nap
              */
             std::string createResource(const rttr::type& resourceType, const std::string& mID = "");
 
+            /**
+             * Values of properties to assign to newly created resources.
+             */
+            using PropertyValues = std::vector<std::pair<rtti::Property, rtti::Variant>>;
+
+            /**
+             * Create multiple resources of the same type at once. Storage is reserved once for all resources.
+             * Groups are added to the root or as children of the parent group, components to the parent entity, other resources to the root or as members of the parent group.
+             * @param type Type of the new resources.
+             * @param mIDs Unique ids of the new resources, for example generated by getUniqueIDs().
+             * @param parentID ID of the group or entity to add the resources to, empty to add them to the root of the tree.
+             * @param values Property values assigned to every new resource.
+             */
+            void createResources(const rttr::type& type, const std::vector<std::string>& mIDs, const std::string& parentID, const PropertyValues& values);
+
+            /**
+             * Generate a number of unique ids from a naming pattern in one go.
+             * @param pattern Naming pattern, the first '#' is replaced by a number. Without '#' the number is appended.
+             * @param count Number of ids to generate.
+             * @return Ids that are not in use, numbered in ascending order.
+             */
+            std::vector<std::string> getUniqueIDs(const std::string& pattern, int count);
+
+            /**
+             * Deep copy resources including their embedded objects, group members and children and entity children.
+             * Property values are copied directly through rtti, pointers between the copied objects are remapped to the copies.
+             * Copies of the given resources are placed next to the originals in the tree.
+             * @param mIDs Ids of the resources to copy.
+             * @param copyIDs Ids of all copies, one for every copied object. When empty unique ids are generated and returned in it,
+             * otherwise the given ids are used, which recreates the exact same copies when the model is in the same state.
+             * @return Ids of the copies of the given resources.
+             */
+            std::vector<std::string> duplicateResources(const std::vector<std::string>& mIDs, std::vector<std::string>& copyIDs);
+
+            /**
+             * Link between a derived resource and the template resource it shares its property values with.
+             * Properties that are not overridden follow the template: edits to the template are copied to the derived resource.
+             * mID and embedded object properties are never shared.
+             */
+            struct Derivation
+            {
+                std::string mTemplateID;                        // mID of the template resource
+                std::unordered_set<std::string> mOverrides;     // Names of the properties the derived resource sets itself
+            };
+            using Derivations = std::vector<std::pair<std::string, Derivation>>;
+
+            /**
+             * Derives a resource from a template resource of the same type.
+             * The values of all properties that are not overridden are copied from the template.
+             * @param mID Id of the resource to derive.
+             * @param templateID Id of the template resource.
+             * @param overrides Names of the properties that keep the value of the derived resource.
+             * @return False if the types differ or the template derives from the resource itself.
+             */
+            bool setTemplate(const std::string& mID, const std::string& templateID, const std::unordered_set<std::string>& overrides);
+
+            /**
+             * Detaches a resource from its template. Its property values are kept.
+             * @param mID Id of the derived resource.
+             */
+            void clearTemplate(const std::string& mID);
+
+            /**
+             * @return The template link of the resource, nullptr if the resource is not derived from a template.
+             */
+            const Derivation* getDerivation(const std::string& mID) const;
+
+            /**
+             * @return Whether any resource in the model is derived from a template.
+             */
+            bool hasTemplates() const { return !mDerivations.empty(); }
+
+            /**
+             * Notifies the model that a property of a resource was changed. Edits of groups and entities change the tree generation.
+             * When the resource is derived from a template the property becomes an override.
+             * When the resource is a template the value is copied to all derived resources that do not override it,
+             * in time proportional to the number of derived resources.
+             * @param mID Id of the changed resource.
+             * @param propertyName Name of the changed property of the resource.
+             */
+            void propertyChanged(const std::string& mID, const std::string& propertyName);
+
+            /**
+             * Removes an override from a derived resource: the property gets the value of the template again.
+             * @param mID Id of the derived resource.
+             * @param propertyName Name of the overridden property.
+             */
+            void revertOverride(const std::string& mID, const std::string& propertyName);
+
+            /**
+             * @param mIDs Ids of resources.
+             * @return The template links in which one of the resources is either the derived resource or the template.
+             */
+            Derivations getDerivations(const std::vector<std::string>& mIDs) const;
+
+            /**
+             * Restores template links as returned by getDerivations(). Property values are not changed.
+             * Links of which the derived resource or the template does not exist are skipped.
+             * @param derivations The links to restore.
+             */
+            void restoreDerivations(const Derivations& derivations);
+
             /**
              * Create a new group.
              * @param groupType Type of the new group. Needs to be a IGroup subclass.
@@ -127,6 +233,52 @@ namespace nap
              */
             void removeResource(const std::string& mID);
 
+            /**
+             * Remove multiple resources with all their embedded objects.
+             * The tree and the list of owned resources are traversed once for all resources together.
+             * @param mIDs Ids of the resources to remove.
+             */
+            void removeResources(const std::vector<std::string>& mIDs);
+
+            /**
+             * Collect a resource and all objects embedded in it, recursively.
+             * @param resource The resource to start from.
+             * @param objects Receives the resource and its embedded objects.
+             */
+            void collectEmbeddedObjects(Resource& resource, std::unordered_set<Resource*>& objects);
+
+            /**
+             * Position of a resource in the tree.
+             */
+            struct TreeLocation
+            {
+                std::string mID;            // mID of the resource
+                std::string mParentID;      // mID of the group containing the resource, empty when it is in the root of the tree
+                int mIndex = -1;            // Index of the resource within the branch of its parent
+            };
+
+            /**
+             * Find the position in the tree of multiple resources in a single pass over the tree.
+             * @param mIDs Ids of the resources to locate.
+             * @return The locations of the resources that were found in the tree, in tree order.
+             */
+            std::vector<TreeLocation> getTreeLocations(const std::vector<std::string>& mIDs);
+
+            /**
+             * Move resources and groups to a group in a single pass over the tree.
+             * Resources become members of the group, groups become children of the group.
+             * Entities, components and groups that contain the target group are not moved.
+             * @param mIDs Ids of the resources to move.
+             * @param groupID ID of the target group, empty to move to the root of the tree.
+             */
+            void moveResources(const std::vector<std::string>& mIDs, const std::string& groupID);
+
+            /**
+             * Put resources back at the given locations in the tree, removing them from their current position in a single pass.
+             * @param locations Locations as returned by getTreeLocations().
+             */
+            void restoreTreeLocations(const std::vector<TreeLocation>& locations);
+
             /**
              * Rename a resource.
              * @param mID Current name.
@@ -134,6 +286,23 @@ namespace nap
              */
             void renameResource(const std::string& mID, const std::string& newName);
 
+            /**
+             * @return Index of the resource in the root of the tree, -1 if the resource is not in the root of the tree.
+             */
+            int getRootIndex(const Resource& resource);
+
+            /**
+             * Insert a resource owned by the model in the root of the tree, in the root list that matches its type.
+             * @param resource The resource to insert.
+             * @param index Position within the root list, clamped to the size of the list.
+             */
+            void insertIntoRoot(Resource& resource, int index);
+
+            /**
+             * @return The factory used to create resources.
+             */
+            rtti::Factory& getFactory();
+
             /**
              * @return All objects in the model as a flat list.
              */
@@ -184,12 +353,80 @@ namespace nap
             bool serialize(std::string& output, utility::ErrorState &errorState);
             bool deserialize(const std::string& input, utility::ErrorState &errorState);
 
+            /**
+             * Writes the model and its template links in the rtti binary format.
+             * Considerably faster than serialize(), but not meant to be edited or kept across versions: used for crash recovery.
+             * @param output Receives the binary data.
+             * @param errorState Contains the error when serialization fails.
+             * @return True on success.
+             */
+            bool serializeBinary(std::vector<uint8_t>& output, utility::ErrorState& errorState);
+
+            /**
+             * Replaces the model with the data written by serializeBinary().
+             * @param data The binary data.
+             * @param size Size of the data in bytes.
+             * @param errorState Contains the error when deserialization fails.
+             * @return True on success.
+             */
+            bool deserializeBinary(const uint8_t* data, size_t size, utility::ErrorState& errorState);
+
             bool loadFromFile(const std::string& path, utility::ErrorState &errorState);
             bool saveToFile(const std::string& path, utility::ErrorState &errorState);
 
+            /**
+             * Notifies listeners that the model has changed and increments the generation of the model.
+             * While notifications are deferred the generation is still incremented, but mChangedSignal is emitted only once when notifications are resumed.
+             */
+            void notifyChanged();
+
+            /**
+             * Defers emitting mChangedSignal until resumeNotifications() is called. Calls can be nested.
+             */
+            void deferNotifications();
+
+            /**
+             * Resumes emitting mChangedSignal. Emits the signal once if the model changed while notifications were deferred.
+             */
+            void resumeNotifications();
+
+            /**
+             * @return Number that is incremented on every change to the model. Can be used to validate cached data derived from the model.
+             */
+            uint64_t getGeneration() const { return mGeneration; }
+
+            /**
+             * @return Number that is incremented when resources are added, removed or renamed, but not when property values change.
+             * Can be used to validate cached pointers to resources.
+             */
+            uint64_t getStructureGeneration() const { return mStructureGeneration; }
+
+            /**
+             * @return Number that changes whenever the tree changes: when resources are added, removed, renamed or moved,
+             * and when a property of a group or entity is edited. Can be used to validate data derived from the tree.
+             */
+            uint64_t getTreeGeneration() const { return mStructureGeneration + mTreeChanges; }
+
             // Signal emitted when the model is cleared.
             Signal<> mClearedSignal;
 
+            // Signal emitted after the model has changed. Emitted once per Controller command or transaction.
+            Signal<> mChangedSignal;
+
+            /**
+             * Signal emitted when a resource is added to the model, also for embedded objects and when a removed resource is restored.
+             * @param mID ID of the added resource.
+             */
+            Signal<const std::string&> mResourceAddedSignal;
+
+            /**
+             * Signal emitted when a property of a resource is edited through the Controller,
+             * when a component or child entity is added to or removed from an entity,
+             * when the resource is detached from its template, or changes because it follows the template it is derived from.
+             * @param mID ID of the edited resource.
+             */
+            Signal<const std::string&> mResourceEditedSignal;
+
             /**
              * Signal emitted when a resource is removed.
              * @param mID ID of the removed resource.
@@ -208,9 +445,30 @@ namespace nap
             bool eraseFromTree(std::vector<ResourcePtr<ResourceGroup>>& branch, Object& resource);
             bool eraseFromTree(std::vector<ResourcePtr<Entity>>& branch, Object& resource);
             bool eraseFromTree(Object& resource);
+            void eraseFromTree(const std::unordered_set<Object*>& objects);
+            bool containsGroup(ResourceGroup& group, const ResourceGroup& other);
 
             std::string getUniqueID(const std::string& baseID);
 
+            // Copies the shared property values of the template to a derived resource, resolves templates of templates first
+            void applyTemplate(const std::string& mID, std::unordered_set<std::string>& applied);
+            // Copies the value of a property of a template to all derived resources that do not override it, recursively
+            void propagate(Resource& resource, const rtti::Property& property);
+            // Removes the template links of a removed resource, resources derived from it are detached
+            void removeDerivation(const std::string& mID);
+            // Removes properties that follow the template from serialized derived resources, except required ones, and adds the template links
+            bool writeDerivations(std::string& json, utility::ErrorState& errorState);
+            // Reads the template links written by writeDerivations()
+            bool readDerivations(const std::string& json, Derivations& derivations, utility::ErrorState& errorState);
+
+            // The groups, resources and entities in the root of the tree, in the order they are serialized
+            std::vector<rtti::Object*> getRootObjects() const;
+            // Replaces the model with deserialized objects and the template links between them
+            bool load(rtti::DeserializeResult& result, const Derivations& derivations, utility::ErrorState& errorState);
+
+            // Takes ownership of the resource and adds it to the flat list and the id index, returns the raw pointer
+            Resource* addResource(std::unique_ptr<Resource> resource);
+
             Slot<> mPreResourcesLoadedSlot;
             void onPreResourcesLoaded();
 
@@ -218,18 +476,28 @@ namespace nap
             void onPostResourcesLoaded();
 
         	std::vector<std::unique_ptr<Resource>> mResources;
+            std::unordered_map<std::string, Resource*> mResourceIndex; // Resources in mResources by mID
             Tree mTree;
+            std::unordered_map<std::string, Derivation> mDerivations;                 // Template links by mID of the derived resource
+            std::unordered_map<std::string, std::vector<std::string>> mDependents;    // mIDs of the derived resources by mID of the template
 
             std::map<std::string, const rtti::TypeInfo*> mResourceTypes;
             std::map<std::string, const rtti::TypeInfo*> mGroupTypes;
 
             Core& mCore;
             std::string mSerializedData;
+
+            uint64_t mGeneration = 0;
+            uint64_t mStructureGeneration = 0;
+            uint64_t mTreeChanges = 0;         // Changes to the tree that do not change the structure generation
+            int mDeferredNotifications = 0;
+            bool mChangePending = false;
         };
 
 
         /**
-         * Represents a selection of a resource owned by the Model
+         * Represents a selection of one or more resources owned by the Model.
+         * One of the selected resources is the lead selection, returned by get(). It is the most recently selected resource.
          */
         class NAPAPI Selector : public Resource
         {
@@ -242,30 +510,64 @@ namespace nap
             bool init(utility::ErrorState &errorState) override;
 
             /**
-             * Selects a resource
+             * Selects a single resource, deselecting all others.
              * @param mID Unique ID of the selected resource
              */
-            void set(const std::string& mID)
-            {
-                assert(mModel->findResource(mID) != nullptr);
-                mSelection = mID;
-            }
+            void set(const std::string& mID);
+
+            /**
+             * Adds a resource to the selection and makes it the lead selection.
+             * @param mID Unique ID of the resource to add.
+             */
+            void add(const std::string& mID);
+
+            /**
+             * Removes a resource from the selection. When it was the lead selection the most recently added remaining resource becomes the lead.
+             * @param mID Unique ID of the resource to remove.
+             */
+            void remove(const std::string& mID);
+
+            /**
+             * Adds the resource to the selection if it is not selected, removes it otherwise.
+             * @param mID Unique ID of the resource.
+             */
+            void toggle(const std::string& mID);
+
+            /**
+             * @return Whether the resource is selected, in constant time.
+             */
+            bool contains(const std::string& mID) const { return mIndex.find(mID) != mIndex.end(); }
 
             /**
-             * @return Return the selection, returns empty string if nothing is selected.
+             * @return Return the lead selection, returns empty string if nothing is selected.
              */
             const std::string& get() const { return mSelection; }
 
+            /**
+             * @return All selected resources, in the order they were selected.
+             */
+            const std::vector<std::string>& getAll() const { return mSelected; }
+
+            /**
+             * @return Number of selected resources.
+             */
+            int size() const { return mSelected.size(); }
+
             /**
              * Clears the selection.
              */
-            void clear() { mSelection.clear(); }
+            void clear();
 
             /**
              * @return Whether the selection is not set.
              */
             bool empty() const { return mSelection.empty(); }
 
+            /**
+             * @return Number that is incremented whenever the selection changes. Can be used to validate data derived from the selection.
+             */
+            uint64_t getVersion() const { return mVersion; }
+
         private:
             Slot<const std::string&> mResourceRemovedSlot = { this, &Selector::onResourceRemoved };
             void onResourceRemoved(const std::string& mID);
@@ -273,22 +575,19 @@ namespace nap
             Slot<const std::string&, const std::string&> mResourceRenamedSlot;
             void onResourceRenamed(const std::string& oldID, const std::string& newID);
 
-            std::string mSelection;
+            std::string mSelection;                                 // Lead selection
+            std::vector<std::string> mSelected;                     // All selected resources in selection order
+            std::unordered_map<std::string, size_t> mIndex;         // Position of each selected resource in mSelected
+            uint64_t mVersion = 0;
         };
 
 
         template<typename T>
         T * Model::findResource(const std::string &mID)
         {
-            auto it = std::find_if(mResources.begin(), mResources.end(), [&mID](const auto& resource) { return resource->mID == mID; });
-            if (it != mResources.end())
-            {
-                auto result = rtti_cast<T>(it->get());
-                if (result != nullptr)
-                    return result;
-                else
-                    return nullptr;
-            }
+            auto resource = findResource(mID);
+            if (resource != nullptr)
+                return rtti_cast<T>(resource);
             return nullptr;
         }
 
@@ -0,0 +1,278 @@
+#include "objectutils.h"
+
+#include <rtti/objectptr.h>
+
+#include <cstring>
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			void visitValue(const rtti::Variant& value, const rtti::Path& path, int arrayIndex, bool isEmbedded, const PointerVisitor& visitor);
+
+
+			void visitProperties(const rtti::Instance& instance, const rtti::TypeInfo& type, const rtti::Path& path, const PointerVisitor& visitor)
+			{
+				for (auto& property : type.get_properties())
+				{
+					auto value = property.get_value(instance);
+					auto propertyPath = path;
+					propertyPath.pushAttribute(property.get_name().to_string());
+					visitValue(value, propertyPath, -1, rtti::hasFlag(property, nap::rtti::EPropertyMetaData::Embedded), visitor);
+				}
+			}
+
+
+			void visitValue(const rtti::Variant& value, const rtti::Path& path, int arrayIndex, bool isEmbedded, const PointerVisitor& visitor)
+			{
+				auto type = value.get_type();
+				if (type.is_derived_from<rtti::ObjectPtrBase>())
+				{
+					rtti::Object* target = value.get_value<rtti::ObjectPtr<rtti::Object>>().get();
+					if (target != nullptr)
+						visitor(path, arrayIndex, isEmbedded, target);
+				}
+				else if (value.is_array())
+				{
+					auto view = value.create_array_view();
+					for (auto i = 0; i < view.get_size(); ++i)
+					{
+						auto element = view.get_value(i);
+						if (element.get_type().is_derived_from<rtti::ObjectPtrBase>())
+							visitValue(element, path, i, isEmbedded, visitor);
+						else
+						{
+							auto elementPath = path;
+							elementPath.pushArrayElement(i);
+							visitValue(element, elementPath, -1, isEmbedded, visitor);
+						}
+					}
+				}
+				else if (type.is_class() && !type.is_wrapper())
+					visitProperties(value, type, path, visitor);
+			}
+
+
+			void writeBytes(std::vector<uint8_t>& output, const void* data, size_t size)
+			{
+				auto bytes = static_cast<const uint8_t*>(data);
+				output.insert(output.end(), bytes, bytes + size);
+			}
+
+
+			bool readBytes(const uint8_t*& data, const uint8_t* end, void* output, size_t size)
+			{
+				if (size_t(end - data) < size)
+					return false;
+				std::memcpy(output, data, size);
+				data += size;
+				return true;
+			}
+
+
+			void writeString(std::vector<uint8_t>& output, const std::string& value)
+			{
+				uint32_t size = value.size();
+				writeBytes(output, &size, sizeof(size));
+				writeBytes(output, value.data(), size);
+			}
+
+
+			bool readString(const uint8_t*& data, const uint8_t* end, std::string& value)
+			{
+				uint32_t size;
+				if (!readBytes(data, end, &size, sizeof(size)) || size_t(end - data) < size)
+					return false;
+				value.assign(reinterpret_cast<const char*>(data), size);
+				data += size;
+				return true;
+			}
+
+
+			// Arithmetic values are written with the size of their own type, returns false when value is not a T
+			template <typename T>
+			bool writeArithmetic(const rtti::Variant& value, std::vector<uint8_t>& output)
+			{
+				if (value.get_type() != RTTI_OF(T))
+					return false;
+				auto arithmetic = value.get_value<T>();
+				writeBytes(output, &arithmetic, sizeof(T));
+				return true;
+			}
+
+
+			// Returns false when value is not a T, success is false when the data is too short
+			template <typename T>
+			bool readArithmetic(const uint8_t*& data, const uint8_t* end, rtti::Variant& value, bool& success)
+			{
+				if (value.get_type() != RTTI_OF(T))
+					return false;
+				T arithmetic;
+				success = readBytes(data, end, &arithmetic, sizeof(T));
+				if (success)
+					value = arithmetic;
+				return true;
+			}
+		}
+
+
+		void visitPointers(rtti::Object& object, const PointerVisitor& visitor)
+		{
+			visitProperties(object, object.get_type(), rtti::Path(), visitor);
+		}
+
+
+		bool setPointer(rtti::Object& object, const rtti::Path& path, int arrayIndex, rtti::Object* target)
+		{
+			rtti::ResolvedPath resolvedPath;
+			if (!path.resolve(&object, resolvedPath))
+				return false;
+			if (arrayIndex < 0)
+				return resolvedPath.setValue(target);
+
+			auto array = resolvedPath.getValue();
+			auto view = array.create_array_view();
+			if (arrayIndex >= view.get_size() || !view.set_value(arrayIndex, target))
+				return false;
+			return resolvedPath.setValue(array);
+		}
+
+
+		bool setPointers(rtti::Object& object, const rtti::Path& path, const std::vector<std::pair<int, rtti::Object*>>& targets)
+		{
+			rtti::ResolvedPath resolvedPath;
+			if (!path.resolve(&object, resolvedPath))
+				return false;
+
+			auto array = resolvedPath.getValue();
+			auto view = array.create_array_view();
+			for (auto& target : targets)
+				if (target.first < 0 || target.first >= view.get_size() || !view.set_value(target.first, target.second))
+					return false;
+			return resolvedPath.setValue(array);
+		}
+
+
+		bool writeValue(const rtti::Variant& value, std::vector<uint8_t>& output)
+		{
+			auto type = value.get_type();
+			if (type.is_derived_from<rtti::ObjectPtrBase>())
+			{
+				rtti::Object* target = value.get_value<rtti::ObjectPtr<rtti::Object>>().get();
+				writeString(output, target != nullptr ? target->mID : std::string());
+				return true;
+			}
+			if (value.is_array())
+			{
+				auto view = value.create_array_view();
+				uint32_t size = view.get_size();
+				writeBytes(output, &size, sizeof(size));
+				for (auto i = 0; i < size; ++i)
+					if (!writeValue(view.get_value(i), output))
+						return false;
+				return true;
+			}
+			if (type.is_enumeration())
+			{
+				writeString(output, type.get_enumeration().value_to_name(value).to_string());
+				return true;
+			}
+			if (type == RTTI_OF(std::string))
+			{
+				writeString(output, value.get_value<std::string>());
+				return true;
+			}
+			if (type.is_arithmetic())
+				return writeArithmetic<bool>(value, output) || writeArithmetic<char>(value, output) ||
+					writeArithmetic<int8_t>(value, output) || writeArithmetic<uint8_t>(value, output) ||
+					writeArithmetic<int16_t>(value, output) || writeArithmetic<uint16_t>(value, output) ||
+					writeArithmetic<int32_t>(value, output) || writeArithmetic<uint32_t>(value, output) ||
+					writeArithmetic<int64_t>(value, output) || writeArithmetic<uint64_t>(value, output) ||
+					writeArithmetic<float>(value, output) || writeArithmetic<double>(value, output);
+			if (type.is_class() && !type.is_wrapper())
+			{
+				for (auto& property : type.get_properties())
+					if (!writeValue(property.get_value(value), output))
+						return false;
+				return true;
+			}
+			return false;
+		}
+
+
+		bool readValue(const uint8_t*& data, const uint8_t* end, rtti::Variant& value, const ObjectResolver& resolve)
+		{
+			auto type = value.get_type();
+			if (type.is_derived_from<rtti::ObjectPtrBase>())
+			{
+				std::string mID;
+				if (!readString(data, end, mID))
+					return false;
+				rtti::Object* target = mID.empty() ? nullptr : resolve(mID);
+				value = target;
+				return true;
+			}
+			if (value.is_array())
+			{
+				// Existing elements serve as the values to read into, new elements are default constructed
+				uint32_t size;
+				auto view = value.create_array_view();
+				if (!readBytes(data, end, &size, sizeof(size)) || !view.set_size(size))
+					return false;
+				for (auto i = 0; i < size; ++i)
+				{
+					auto element = view.get_value(i);
+					if (!readValue(data, end, element, resolve) || !view.set_value(i, element))
+						return false;
+				}
+				return true;
+			}
+			if (type.is_enumeration())
+			{
+				std::string name;
+				if (!readString(data, end, name))
+					return false;
+				auto enumValue = type.get_enumeration().name_to_value(name);
+				if (!enumValue.is_valid())
+					return false;
+				value = enumValue;
+				return true;
+			}
+			if (type == RTTI_OF(std::string))
+			{
+				std::string string;
+				if (!readString(data, end, string))
+					return false;
+				value = string;
+				return true;
+			}
+			if (type.is_arithmetic())
+			{
+				bool success = false;
+				return (readArithmetic<bool>(data, end, value, success) || readArithmetic<char>(data, end, value, success) ||
+					readArithmetic<int8_t>(data, end, value, success) || readArithmetic<uint8_t>(data, end, value, success) ||
+					readArithmetic<int16_t>(data, end, value, success) || readArithmetic<uint16_t>(data, end, value, success) ||
+					readArithmetic<int32_t>(data, end, value, success) || readArithmetic<uint32_t>(data, end, value, success) ||
+					readArithmetic<int64_t>(data, end, value, success) || readArithmetic<uint64_t>(data, end, value, success) ||
+					readArithmetic<float>(data, end, value, success) || readArithmetic<double>(data, end, value, success)) && success;
+			}
+			if (type.is_class() && !type.is_wrapper())
+			{
+				for (auto& property : type.get_properties())
+				{
+					auto propertyValue = property.get_value(value);
+					if (!readValue(data, end, propertyValue, resolve) || !property.set_value(value, propertyValue))
+						return false;
+				}
+				return true;
+			}
+			return false;
+		}
+
+	}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <utility/dllexport.h>
+#include <rtti/object.h>
+#include <rtti/path.h>
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Called for every pointer that is found while visiting the properties of an object.
+		 * For pointers in arrays path points to the array and arrayIndex is the index of the pointer, otherwise arrayIndex is -1.
+		 * isEmbedded is true for pointers to embedded objects.
+		 */
+		using PointerVisitor = std::function<void(const rtti::Path& path, int arrayIndex, bool isEmbedded, rtti::Object* target)>;
+
+		/**
+		 * Calls visitor for every pointer that is set in the properties of object, including pointers in arrays and nested structs.
+		 * @param object The object to visit.
+		 * @param visitor Called for every pointer that is not null.
+		 */
+		NAPAPI void visitPointers(rtti::Object& object, const PointerVisitor& visitor);
+
+		/**
+		 * Sets a pointer in the properties of an object, at a location reported by visitPointers().
+		 * @param object The object containing the pointer.
+		 * @param path Path to the pointer, or to the array containing the pointer.
+		 * @param arrayIndex Index of the pointer in the array, -1 if the pointer is not an array element.
+		 * @param target The new target of the pointer.
+		 * @return True on success.
+		 */
+		NAPAPI bool setPointer(rtti::Object& object, const rtti::Path& path, int arrayIndex, rtti::Object* target);
+
+		/**
+		 * Sets multiple pointers in one array in the properties of an object, reading and writing the array once.
+		 * @param object The object containing the array.
+		 * @param path Path to the array, as reported by visitPointers().
+		 * @param targets Index in the array and new target of every pointer to set.
+		 * @return True on success.
+		 */
+		NAPAPI bool setPointers(rtti::Object& object, const rtti::Path& path, const std::vector<std::pair<int, rtti::Object*>>& targets);
+
+		/**
+		 * Finds the object with the given mID while reading values, returns null when it does not exist.
+		 */
+		using ObjectResolver = std::function<rtti::Object*(const std::string& mID)>;
+
+		/**
+		 * Appends a property value to output in a compact binary form, used to keep undo data out of memory.
+		 * Pointers are written as the mID of their target, arrays and structs are written recursively.
+		 * @param value The value to write.
+		 * @param output Receives the binary data.
+		 * @return False when the value contains a type that has no binary form.
+		 */
+		NAPAPI bool writeValue(const rtti::Variant& value, std::vector<uint8_t>& output);
+
+		/**
+		 * Reads a value written by writeValue().
+		 * @param data Position of the value, advanced past it.
+		 * @param end End of the data.
+		 * @param value Holds a value of the written type, which determines how the data is read. Receives the read value.
+		 * @param resolve Finds the targets of pointers, pointers to objects that no longer exist are read as null.
+		 * @return False when the data does not contain a value of the type of value.
+		 */
+		NAPAPI bool readValue(const uint8_t*& data, const uint8_t* end, rtti::Variant& value, const ObjectResolver& resolve);
+
+	}
+}
@@ -0,0 +1,436 @@
+#include "propertyindex.h"
+#include "objectutils.h"
+
+#include <rtti/objectptr.h>
+#include <utility/stringutils.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			void appendValue(const rtti::Variant& value, std::string& text);
+
+
+			void appendProperties(const rtti::Instance& instance, const rtti::TypeInfo& type, std::string& text)
+			{
+				for (auto& property : type.get_properties())
+					if (property.get_name() != "mID")
+						appendValue(property.get_value(instance), text);
+			}
+
+
+			// Appends string, enum and numeric values as text, one value per line. Pointers are skipped, embedded objects are indexed themselves.
+			void appendValue(const rtti::Variant& value, std::string& text)
+			{
+				auto type = value.get_type();
+				if (type == RTTI_OF(std::string))
+				{
+					text += value.get_value<std::string>();
+					text += '\n';
+				}
+				else if (type.is_enumeration())
+				{
+					auto name = type.get_enumeration().value_to_name(value);
+					text.append(name.data(), name.size());
+					text += '\n';
+				}
+				else if (type.is_arithmetic())
+				{
+					text += value.to_string();
+					text += '\n';
+				}
+				else if (type.is_derived_from<rtti::ObjectPtrBase>())
+					return;
+				else if (value.is_array())
+				{
+					auto view = value.create_array_view();
+					for (auto i = 0; i < view.get_size(); ++i)
+						appendValue(view.get_value(i), text);
+				}
+				else if (type.is_class() && !type.is_wrapper())
+					appendProperties(value, type, text);
+			}
+		}
+
+
+		PropertyIndex::~PropertyIndex()
+		{
+			if (!mThread.joinable())
+				return;
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStopping = true;
+			}
+			mCondition.notify_one();
+			mThread.join();
+		}
+
+
+		void PropertyIndex::init(Model& model, Controller& controller)
+		{
+			mModel = &model;
+			mController = &controller;
+			mModel->mResourceAddedSignal.connect(mAddedSlot);
+			mModel->mResourceEditedSignal.connect(mEditedSlot);
+			mModel->mResourceRemovedSignal.connect(mRemovedSlot);
+			mModel->mResourceRenamedSignal.connect(mRenamedSlot);
+			mModel->mClearedSignal.connect(mClearedSlot);
+
+			for (auto& resource : mModel->getResources())
+				mPending.emplace(resource->mID);
+			mThread = std::thread([this](){ indexThread(); });
+		}
+
+
+		void PropertyIndex::update(std::chrono::microseconds budget)
+		{
+			// Edits during an edit session are extracted once, when the session ends, instead of every frame
+			if (mPending.empty() || mController->isEditing())
+				return;
+
+			// Extracting the values reads the model, which can only be done on this thread
+			auto deadline = std::chrono::steady_clock::now() + budget;
+			std::vector<Job> jobs;
+			auto it = mPending.begin();
+			while (it != mPending.end())
+			{
+				auto resource = mModel->findResource(*it);
+				if (resource != nullptr)
+				{
+					Job job = { EJobType::Index, *it };
+					appendProperties(*resource, resource->get_type(), job.mText);
+					jobs.emplace_back(std::move(job));
+				}
+				it = mPending.erase(it);
+				if (jobs.size() % 16 == 0 && std::chrono::steady_clock::now() >= deadline)
+					break;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				std::move(jobs.begin(), jobs.end(), std::back_inserter(mJobs));
+			}
+			mCondition.notify_one();
+		}
+
+
+		void PropertyIndex::setQuery(const char* query)
+		{
+			// Compared without converting, the query is set every frame
+			auto length = std::strlen(query);
+			if (length == mQuery.size() && std::equal(query, query + length, mQuery.begin(), [](unsigned char a, char b){ return std::tolower(a) == b; }))
+				return;
+			mQuery = utility::toLower(query);
+			post({ EJobType::Query, "", "", mQuery });
+		}
+
+
+		bool PropertyIndex::fetchResults(std::vector<std::string>& mIDs)
+		{
+			std::vector<std::string> results;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+
+				// Results of a previous query are still published until the background thread picks up the new one
+				if (!mResultsChanged || mResultsQuery != mQuery)
+					return false;
+				results = mResults;
+				mResultsChanged = false;
+			}
+
+			// Embedded objects are not listed themselves, a match in one is a match of its owner
+			updateOwners();
+			std::unordered_set<std::string> reported;
+			mIDs.clear();
+			mIDs.reserve(results.size());
+			for (auto& mID : results)
+			{
+				auto owner = mOwners.find(mID);
+				auto& ownerID = owner != mOwners.end() ? owner->second : mID;
+				if (reported.emplace(ownerID).second)
+					mIDs.emplace_back(ownerID);
+			}
+			return true;
+		}
+
+
+		void PropertyIndex::updateOwners()
+		{
+			if (mOwnersGeneration == mModel->getStructureGeneration())
+				return;
+
+			// The direct owner of every embedded object. Components are listed under their entity and keep their own mID.
+			std::unordered_map<std::string, std::string> parents;
+			for (auto& resource : mModel->getResources())
+			{
+				auto& parentID = resource->mID;
+				visitPointers(*resource, [&](const rtti::Path&, int, bool isEmbedded, rtti::Object* target)
+				{
+					if (isEmbedded && !target->get_type().is_derived_from(RTTI_OF(Component)))
+						parents.emplace(target->mID, parentID);
+				});
+			}
+
+			// Follow objects embedded in embedded objects up to the owner that is not embedded itself
+			mOwners.clear();
+			mOwners.reserve(parents.size());
+			for (auto& parent : parents)
+			{
+				auto ownerID = parent.second;
+				for (auto depth = 0; depth < parents.size(); ++depth)
+				{
+					auto next = parents.find(ownerID);
+					if (next == parents.end())
+						break;
+					ownerID = next->second;
+				}
+				mOwners.emplace(parent.first, std::move(ownerID));
+			}
+			mOwnersGeneration = mModel->getStructureGeneration();
+		}
+
+
+		bool PropertyIndex::isIndexing() const
+		{
+			if (!mPending.empty())
+				return true;
+			std::lock_guard<std::mutex> lock(mMutex);
+			return mBusy || !mJobs.empty();
+		}
+
+
+		void PropertyIndex::onResourceChanged(const std::string& mID)
+		{
+			mPending.emplace(mID);
+		}
+
+
+		void PropertyIndex::onResourceRemoved(const std::string& mID)
+		{
+			mPending.erase(mID);
+			post({ EJobType::Remove, mID });
+		}
+
+
+		void PropertyIndex::onResourceRenamed(const std::string& oldID, const std::string& newID)
+		{
+			if (mPending.erase(oldID) > 0)
+				mPending.emplace(newID);
+			post({ EJobType::Rename, oldID, newID });
+		}
+
+
+		void PropertyIndex::onCleared()
+		{
+			mPending.clear();
+			post({ EJobType::Clear });
+		}
+
+
+		void PropertyIndex::post(Job&& job)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mJobs.emplace_back(std::move(job));
+			}
+			mCondition.notify_one();
+		}
+
+
+		void PropertyIndex::indexThread()
+		{
+			std::vector<Job> jobs;
+			while (true)
+			{
+				{
+					std::unique_lock<std::mutex> lock(mMutex);
+					mCondition.wait(lock, [this](){ return mStopping || !mJobs.empty(); });
+					if (mStopping)
+						return;
+					std::swap(jobs, mJobs);
+					mBusy = true;
+				}
+
+				bool queried = false;
+				bool indexChanged = false;
+				for (auto& job : jobs)
+				{
+					if (job.mType == EJobType::Query)
+						queried = true;
+					else
+						indexChanged = true;
+					process(job);
+				}
+				jobs.clear();
+
+				// Publish the results after every batch, so they grow while the index is being built
+				if (queried || (indexChanged && !mActiveQuery.empty()))
+					runQuery();
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				mBusy = false;
+			}
+		}
+
+
+		void PropertyIndex::process(Job& job)
+		{
+			switch (job.mType)
+			{
+				case EJobType::Index:
+				{
+					auto existing = mDocumentIndex.find(job.mID);
+					if (existing != mDocumentIndex.end())
+						removeDocument(existing->second);
+
+					int document;
+					if (!mFreeDocuments.empty())
+					{
+						document = mFreeDocuments.back();
+						mFreeDocuments.pop_back();
+					}
+					else
+					{
+						document = mDocuments.size();
+						mDocuments.emplace_back();
+					}
+
+					auto& entry = mDocuments[document];
+					entry.mID = job.mID;
+					entry.mText = utility::toLower(job.mText);
+					tokenize(entry.mText, entry.mTokens);
+					for (auto& token : entry.mTokens)
+						mPostings[token].emplace_back(document);
+					mDocumentIndex.emplace(job.mID, document);
+					break;
+				}
+				case EJobType::Remove:
+				{
+					auto existing = mDocumentIndex.find(job.mID);
+					if (existing != mDocumentIndex.end())
+						removeDocument(existing->second);
+					break;
+				}
+				case EJobType::Rename:
+				{
+					auto existing = mDocumentIndex.find(job.mID);
+					if (existing == mDocumentIndex.end())
+						break;
+					int document = existing->second;
+					mDocumentIndex.erase(existing);
+					mDocuments[document].mID = job.mNewID;
+					mDocumentIndex.emplace(job.mNewID, document);
+					break;
+				}
+				case EJobType::Clear:
+					mDocuments.clear();
+					mFreeDocuments.clear();
+					mDocumentIndex.clear();
+					mPostings.clear();
+					break;
+				case EJobType::Query:
+					mActiveQuery = job.mText;
+					break;
+			}
+		}
+
+
+		void PropertyIndex::removeDocument(int document)
+		{
+			auto& entry = mDocuments[document];
+			for (auto& token : entry.mTokens)
+			{
+				auto posting = mPostings.find(token);
+				assert(posting != mPostings.end());
+				auto& documents = posting->second;
+				auto it = std::find(documents.begin(), documents.end(), document);
+				assert(it != documents.end());
+				*it = documents.back();
+				documents.pop_back();
+				if (documents.empty())
+					mPostings.erase(posting);
+			}
+			mDocumentIndex.erase(entry.mID);
+			entry = Document();
+			mFreeDocuments.emplace_back(document);
+		}
+
+
+		void PropertyIndex::runQuery()
+		{
+			std::vector<std::string> results;
+			if (!mActiveQuery.empty())
+			{
+				std::vector<std::string> words;
+				tokenize(mActiveQuery, words);
+
+				// Documents that have a token starting with every word of the query
+				std::vector<int> candidates;
+				bool first = true;
+				for (auto& word : words)
+				{
+					std::vector<int> documents;
+					for (auto it = mPostings.lower_bound(word); it != mPostings.end() && it->first.compare(0, word.size(), word) == 0; ++it)
+						documents.insert(documents.end(), it->second.begin(), it->second.end());
+					std::sort(documents.begin(), documents.end());
+					documents.erase(std::unique(documents.begin(), documents.end()), documents.end());
+					if (first)
+						candidates = std::move(documents);
+					else
+					{
+						std::vector<int> intersection;
+						std::set_intersection(candidates.begin(), candidates.end(), documents.begin(), documents.end(), std::back_inserter(intersection));
+						candidates = std::move(intersection);
+					}
+					first = false;
+					if (candidates.empty())
+						break;
+				}
+
+				// A query without words, like a single slash, is tested against all documents
+				if (words.empty())
+					for (auto& document : mDocumentIndex)
+						candidates.emplace_back(document.second);
+
+				// The words have to appear together as in the query
+				for (auto document : candidates)
+					if (mDocuments[document].mText.find(mActiveQuery) != std::string::npos)
+						results.emplace_back(mDocuments[document].mID);
+			}
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mResults = std::move(results);
+			mResultsQuery = mActiveQuery;
+			mResultsChanged = true;
+		}
+
+
+		void PropertyIndex::tokenize(const std::string& lowerCase, std::vector<std::string>& tokens)
+		{
+			tokens.clear();
+			auto begin = lowerCase.begin();
+			while (begin != lowerCase.end())
+			{
+				begin = std::find_if(begin, lowerCase.end(), [](unsigned char c){ return std::isalnum(c); });
+				auto end = std::find_if(begin, lowerCase.end(), [](unsigned char c){ return !std::isalnum(c); });
+				if (begin != end)
+					tokens.emplace_back(begin, end);
+				begin = end;
+			}
+			std::sort(tokens.begin(), tokens.end());
+			tokens.erase(std::unique(tokens.begin(), tokens.end()), tokens.end());
+		}
+
+	}
+
+}
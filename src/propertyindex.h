@@ -0,0 +1,147 @@
+#pragma once
+
+#include <model.h>
+#include <controller.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Full-text search over the property values of all resources in a Model.
+		 * String, enum and numeric values are tokenized into an inverted index that is kept on a background thread.
+		 * The model is only read on the main thread: update() extracts the values of added and edited resources within a time budget per frame
+		 * and hands them to the background thread, which does the tokenizing, indexing and querying.
+		 * Resources edited during an edit session of the Controller are extracted once, when the session ends.
+		 * Embedded objects are indexed on their own, their matches are reported as matches of the resource that owns them.
+		 * Query results are published while the index is being built, so they fill in as the index grows.
+		 *
+		 * A resource matches when one of its values contains the query, with every word of the query starting at a word in the value.
+		 * Matching is case insensitive.
+		 */
+		class NAPAPI PropertyIndex
+		{
+		public:
+			PropertyIndex() = default;
+			~PropertyIndex();
+			PropertyIndex(const PropertyIndex&) = delete;
+			PropertyIndex& operator=(const PropertyIndex&) = delete;
+
+			/**
+			 * Starts following the model and starts the background thread. All resources currently in the model are indexed.
+			 * @param model The model to index.
+			 * @param controller The controller that edits the model, nothing is extracted while it runs an edit session.
+			 */
+			void init(Model& model, Controller& controller);
+
+			/**
+			 * Extracts the values of pending resources and passes them to the background thread. Call once per frame.
+			 * @param budget Maximum time to spend extracting values.
+			 */
+			void update(std::chrono::microseconds budget = std::chrono::microseconds(2000));
+
+			/**
+			 * Sets the query, results are published asynchronously. An empty query clears the results.
+			 * Setting the same query again does nothing, so it can be called every frame.
+			 */
+			void setQuery(const char* query);
+
+			/**
+			 * Takes the latest results of the current query, if they changed since the last call.
+			 * @param mIDs Receives the mIDs of all matching resources found so far, embedded objects replaced by their owner.
+			 * @return True if mIDs received new results.
+			 */
+			bool fetchResults(std::vector<std::string>& mIDs);
+
+			/**
+			 * @return Whether resources are waiting to be indexed, in which case the results can still grow.
+			 */
+			bool isIndexing() const;
+
+		private:
+			enum class EJobType
+			{
+				Index,		// Replace the values of mID with mText
+				Remove,		// Remove mID
+				Rename,		// Rename mID to mNewID
+				Clear,		// Remove all resources
+				Query		// Run query mText
+			};
+
+			struct Job
+			{
+				EJobType mType;
+				std::string mID;
+				std::string mNewID;
+				std::string mText;
+			};
+
+			// A resource in the index
+			struct Document
+			{
+				std::string mID;
+				std::string mText;						// Lower case values, separated by newlines
+				std::vector<std::string> mTokens;		// Distinct tokens of mText
+			};
+
+			void post(Job&& job);
+			void indexThread();
+			void process(Job& job);
+			void removeDocument(int document);
+			void runQuery();
+			static void tokenize(const std::string& lowerCase, std::vector<std::string>& tokens);
+			void updateOwners();
+
+			Slot<const std::string&> mAddedSlot = { this, &PropertyIndex::onResourceChanged };
+			Slot<const std::string&> mEditedSlot = { this, &PropertyIndex::onResourceChanged };
+			void onResourceChanged(const std::string& mID);
+
+			Slot<const std::string&> mRemovedSlot = { this, &PropertyIndex::onResourceRemoved };
+			void onResourceRemoved(const std::string& mID);
+
+			Slot<const std::string&, const std::string&> mRenamedSlot = { this, &PropertyIndex::onResourceRenamed };
+			void onResourceRenamed(const std::string& oldID, const std::string& newID);
+
+			Slot<> mClearedSlot = { this, &PropertyIndex::onCleared };
+			void onCleared();
+
+			// Main thread
+			Model* mModel = nullptr;
+			Controller* mController = nullptr;
+			std::unordered_set<std::string> mPending;					// Resources of which the values have to be extracted
+			std::string mQuery;
+			std::unordered_map<std::string, std::string> mOwners;		// Resource that owns every embedded object
+			uint64_t mOwnersGeneration = std::numeric_limits<uint64_t>::max();	// Structure generation of the model mOwners was built for
+
+			// Shared, guarded by mMutex
+			std::thread mThread;
+			mutable std::mutex mMutex;
+			std::condition_variable mCondition;
+			std::vector<Job> mJobs;										// Jobs waiting for the background thread
+			bool mStopping = false;
+			bool mBusy = false;											// Whether the background thread is processing jobs
+			std::string mResultsQuery;									// Query the results belong to
+			std::vector<std::string> mResults;
+			bool mResultsChanged = false;
+
+			// Background thread
+			std::vector<Document> mDocuments;
+			std::vector<int> mFreeDocuments;							// Unused slots in mDocuments
+			std::unordered_map<std::string, int> mDocumentIndex;		// Documents by mID
+			std::map<std::string, std::vector<int>> mPostings;			// Documents by token, ordered to look up prefixes
+			std::string mActiveQuery;									// Lower case query, rerun when the index changes
+		};
+
+	}
+}
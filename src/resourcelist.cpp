@@ -2,6 +2,9 @@
 
 #include "imguiservice.h"
 #include "nap/logger.h"
+#include "allocationcounter.h"
+
+#include <numeric>
 
 RTTI_BEGIN_CLASS_NO_DEFAULT_CONSTRUCTOR(nap::edit::ResourceList)
 	RTTI_CONSTRUCTOR(nap::Core&)
@@ -21,6 +24,10 @@ namespace nap
 		ResourceList::ResourceList(Core &core): mCore(core)
 		{
 			memset(mRenameBuffer, 0, sizeof(mRenameBuffer));
+			memset(mLabelBuffer, 0, sizeof(mLabelBuffer));
+			memset(mCopyPattern, 0, sizeof(mCopyPattern));
+			memset(mFindBuffer, 0, sizeof(mFindBuffer));
+			memset(mReplaceBuffer, 0, sizeof(mReplaceBuffer));
 			mGuiService = core.getService<IMGuiService>();
 		}
 
@@ -29,26 +36,74 @@ namespace nap
 		{
 			mModel = mSelector->mModel;
 			mSearchFilter[0] = '\0';
+			mOrder.init(*mModel);
+			mPropertyIndex.init(*mModel, *mController);
+			mModel->mResourceRemovedSignal.connect(mResourceRemovedSlot);
+			mModel->mClearedSignal.connect(mClearedSlot);
 			return true;
 		}
 
 
+		void ResourceList::onResourceRemoved(const std::string& mID)
+		{
+			auto resource = mModel->findResource(mID);
+			if (resource != nullptr)
+				mExpanded.erase(resource);
+		}
+
+
+		void ResourceList::onCleared()
+		{
+			mExpanded.clear();
+		}
+
+
 		void ResourceList::draw()
 		{
+			auto allocations = getAllocationCount();
 			ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
 
+			// Choose view mode
+			static const char* viewModes[] = { "Tree", "By name", "By type", "Group by type", "Recently edited" };
+			int viewMode = int(mViewMode);
+			ImGui::SetNextItemWidth(120.f * mGuiService->getScale());
+			if (ImGui::Combo("##ViewMode", &viewMode, viewModes, IM_ARRAYSIZE(viewModes)))
+			{
+				mViewMode = EViewMode(viewMode);
+				mRowsDirty = true;
+			}
+			ImGui::SameLine();
+
+			// Choose whether to search names or property values
+			static const char* searchModes[] = { "Names", "Values" };
+			int searchMode = mSearchValues ? 1 : 0;
+			ImGui::SetNextItemWidth(80.f * mGuiService->getScale());
+			if (ImGui::Combo("##SearchMode", &searchMode, searchModes, IM_ARRAYSIZE(searchModes)))
+			{
+				mSearchValues = searchMode == 1;
+				mFilterValid = false;
+				mRowsDirty = true;
+			}
+			ImGui::SameLine();
+
 			// Apply search filter
 			ImGui::SetNextItemWidth(ImGui::GetContentRegionAvailWidth());
-			ImGui::InputText("##SearchInput", mSearchFilter, sizeof(mSearchFilter));
-			mFilteredResources.clear();
-			if (isFiltering())
+			if (ImGui::InputText("##SearchInput", mSearchFilter, sizeof(mSearchFilter)))
+				mRowsDirty = true;
+
+			// Property values are searched in the background, the results fill in as they arrive
+			mPropertyIndex.update();
+			mPropertyIndex.setQuery(mSearchValues ? mSearchFilter : "");
+			if (mSearchValues && mPropertyIndex.fetchResults(mValueResults))
 			{
-				auto lowerCaseFilter = utility::toLower(mSearchFilter);
-				filterTree(lowerCaseFilter, mModel->getTree().mResources, mFilteredResources);
-				filterTree(lowerCaseFilter, mModel->getTree().mGroups, mFilteredResources);
-				filterTree(lowerCaseFilter, mModel->getTree().mEntities, mFilteredResources);
+				mFilterValid = false;
+				mRowsDirty = true;
 			}
 
+			// The rows are only rebuilt when the tree, the filter, the expansion state or the order of a flat view has changed
+			if (mRowsDirty || mRowsGeneration != mModel->getTreeGeneration() || (mViewMode != EViewMode::Tree && mRowsOrderVersion != mOrder.getVersion()))
+				rebuildRows();
+
 			// Draw column headers
 			ImGui::BeginColumns("##ResourcesListColumns", 2);
 			mNameColumnOffset = ImGui::GetCursorPosX();
@@ -57,6 +112,10 @@ namespace nap
 			ImGui::NextColumn();
 			mTypeColumnOffset = ImGui::GetCursorPosX() + mLayoutConstants->columnContentShift();
 			ImGui::Text("Type");
+#ifdef NAPEDIT_COUNT_ALLOCATIONS
+			ImGui::SameLine();
+			ImGui::Text("(%d allocations)", int(mFrameAllocations));
+#endif
 			ImGui::EndColumns();
 			ImGui::PopStyleColor();
 
@@ -78,10 +137,10 @@ namespace nap
 				mEntitiesNodeSelected = false;
 				mSelector->clear();
 			}
+			acceptDrop("");
 			if (resourceTreeOpen)
 			{
-				drawTree(mModel->getTree().mGroups, mNameColumnOffset + mLayoutConstants->nameColumnIndent());
-				drawTree(mModel->getTree().mResources, mNameColumnOffset + mLayoutConstants->nameColumnIndent());
+				drawRows(mResourceRows);
 				ImGui::TreePop();
 			}
 			ImGui::PopStyleVar();
@@ -101,7 +160,7 @@ namespace nap
 			}
 			if (entityTreeOpen)
 			{
-				drawTree(mModel->getTree().mEntities, mNameColumnOffset + mLayoutConstants->nameColumnIndent());
+				drawRows(mEntityRows);
 				ImGui::TreePop();
 			}
 			ImGui::PopStyleVar();
@@ -114,6 +173,9 @@ namespace nap
 
 			ImGui::EndChild();
 
+			if (mDropPending)
+				applyDrop();
+
 			// Handle renaming
 			if (!mEditedID.empty() && ImGui::IsMouseClicked(0))
 				mEnteredID = mRenameBuffer;
@@ -241,21 +303,115 @@ namespace nap
 					}
 				}
 
-				// For all selections
-				if (!mSelector->empty())
+				if (!mSelector->empty() && ImGui::Selectable("Duplicate"))
 				{
-					if (ImGui::Selectable(std::string("Rename " + mSelector->get()).c_str()))
+					auto copies = mController->duplicate(mSelector->getAll());
+					mSelector->clear();
+					for (auto& mID : copies)
+						mSelector->add(mID);
+				}
+
+				// For multiple selected resources
+				if (mSelector->size() > 1)
+				{
+					snprintf(mLabelBuffer, sizeof(mLabelBuffer), "Move %d resources to group...", mSelector->size());
+					if (ImGui::Selectable(mLabelBuffer))
+					{
+						std::vector<std::string> groups;
+						for (auto& resource : mModel->getResources())
+							if (rtti_cast<ResourceGroup>(resource.get()) != nullptr && !mSelector->contains(resource->mID))
+								groups.emplace_back(resource->mID);
+						if (!groups.empty())
+						{
+							mFilterMenu.init(std::move(groups));
+							chosenPopup = "##MoveToGroupPopup";
+						}
+					}
+					snprintf(mLabelBuffer, sizeof(mLabelBuffer), "Remove %d resources", mSelector->size());
+					if (ImGui::Selectable(mLabelBuffer))
+					{
+						auto selection = mSelector->getAll();
+						mSelector->clear();
+						mController->removeResources(selection);
+					}
+				}
+
+				// For a single selected resource
+				else if (!mSelector->empty())
+				{
+					auto selected = mModel->findResource(mSelector->get());
+					if (selectedGroup == nullptr && selectedEntity == nullptr && ImGui::Selectable("Create copies..."))
+					{
+						// Copies end up next to the template: in the same group, or on the same entity for components
+						mCopyTemplateID = selected->mID;
+						mCopyParentID.clear();
+						if (selected->get_type().is_derived_from(RTTI_OF(Component)))
+						{
+							for (auto& resource : mModel->getResources())
+							{
+								auto entity = rtti_cast<Entity>(resource.get());
+								if (entity != nullptr && std::find(entity->mComponents.begin(), entity->mComponents.end(), selected) != entity->mComponents.end())
+									mCopyParentID = entity->mID;
+							}
+						}
+						else
+						{
+							auto locations = mModel->getTreeLocations({ selected->mID });
+							if (!locations.empty())
+								mCopyParentID = locations.front().mParentID;
+						}
+						snprintf(mCopyPattern, sizeof(mCopyPattern), "%s_#", selected->mID.c_str());
+						chosenPopup = "##CreateCopiesPopup";
+					}
+
+					// Templates
+					bool isTemplatable = selectedGroup == nullptr && selectedEntity == nullptr && !selected->get_type().is_derived_from(RTTI_OF(Component));
+					if (isTemplatable && ImGui::Selectable("Create derived"))
+					{
+						auto mID = mController->createDerived(selected->mID);
+						mSelector->set(mID);
+					}
+					if (isTemplatable && ImGui::Selectable("Derive from..."))
+					{
+						std::vector<std::string> templates;
+						for (auto& resource : mModel->getResources())
+							if (resource.get() != selected && resource->get_type() == selected->get_type())
+								templates.emplace_back(resource->mID);
+						if (!templates.empty())
+						{
+							mFilterMenu.init(std::move(templates));
+							chosenPopup = "##DeriveFromPopup";
+						}
+					}
+					auto derivation = mModel->getDerivation(selected->mID);
+					if (derivation != nullptr)
+					{
+						snprintf(mLabelBuffer, sizeof(mLabelBuffer), "Detach from %s", derivation->mTemplateID.c_str());
+						if (ImGui::Selectable(mLabelBuffer))
+							mController->setTemplate(selected->mID, "");
+					}
+
+					snprintf(mLabelBuffer, sizeof(mLabelBuffer), "Rename %s", mSelector->get().c_str());
+					if (ImGui::Selectable(mLabelBuffer))
 					{
 						mEditedID = mSelector->get();
 						strcpy(mRenameBuffer, mEditedID.c_str());
 					}
-					if (ImGui::Selectable(std::string("Remove " + mSelector->get()).c_str()))
+					snprintf(mLabelBuffer, sizeof(mLabelBuffer), "Remove %s", mSelector->get().c_str());
+					if (ImGui::Selectable(mLabelBuffer))
 					{
 						mController->removeResource(mSelector->get());
 						mSelector->clear();
 					}
 				}
 
+				ImGui::Separator();
+				if (ImGui::Selectable("Find and replace..."))
+				{
+					mFindReplace.scan(*mModel, mFindBuffer, mReplaceBuffer, mFindMatchCase, mFindNumbers);
+					chosenPopup = "##FindReplacePopup";
+				}
+
 				ImGui::EndPopup();
 			}
 
@@ -296,12 +452,52 @@ namespace nap
 				{
 					auto child = mFilterMenu.getSelectedItem();
 					if (!mSelector->empty())
-						mModel->addEntityToParent(child, mSelector->get());
+						mController->addChildEntity(child, mSelector->get());
 					mSelector->clear();
 				}
 				ImGui::EndPopup();
 			}
 
+			ImGui::SetNextWindowBgAlpha(0.5f);
+			if (ImGui::BeginPopup("##CreateCopiesPopup"))
+			{
+				ImGui::InputInt("Count", &mCopyCount);
+				mCopyCount = std::max(mCopyCount, 1);
+				ImGui::InputText("Name", mCopyPattern, sizeof(mCopyPattern));
+				if (ImGui::Button("Create"))
+				{
+					auto templateResource = mModel->findResource(mCopyTemplateID);
+					if (templateResource != nullptr)
+						mController->createResources(templateResource->get_type(), mCopyCount, mCopyPattern, mCopyParentID, mCopyTemplateID);
+					ImGui::CloseCurrentPopup();
+				}
+				ImGui::EndPopup();
+			}
+
+			ImGui::SetNextWindowBgAlpha(0.5f);
+			if (ImGui::BeginPopup("##DeriveFromPopup"))
+			{
+				if (mFilterMenu.show() && !mSelector->empty())
+					if (!mController->setTemplate(mSelector->get(), mFilterMenu.getSelectedItem()))
+						Logger::warn("%s can not be derived from %s", mSelector->get().c_str(), mFilterMenu.getSelectedItem().c_str());
+				ImGui::EndPopup();
+			}
+
+			ImGui::SetNextWindowBgAlpha(0.5f);
+			if (ImGui::BeginPopup("##FindReplacePopup"))
+			{
+				drawFindReplace();
+				ImGui::EndPopup();
+			}
+
+			ImGui::SetNextWindowBgAlpha(0.5f);
+			if (ImGui::BeginPopup("##MoveToGroupPopup"))
+			{
+				if (mFilterMenu.show())
+					mController->moveResources(mSelector->getAll(), mFilterMenu.getSelectedItem());
+				ImGui::EndPopup();
+			}
+
 			ImGui::SetNextWindowBgAlpha(0.5f);
 			if (ImGui::BeginPopup("##AddComponentPopup"))
 			{
@@ -315,6 +511,413 @@ namespace nap
 				ImGui::EndPopup();
 			}
 
+			mFrameAllocations = getAllocationCount() - allocations;
+		}
+
+
+		void ResourceList::select(const std::string& mID)
+		{
+			if (ImGui::GetIO().KeyCtrl)
+			{
+				mSelector->toggle(mID);
+				return;
+			}
+
+			if (ImGui::GetIO().KeyShift && !mSelector->empty())
+			{
+				// Select all visible rows between the lead selection and the clicked row
+				std::vector<Resource*> rows;
+				rows.reserve(mResourceRows.size() + mEntityRows.size());
+				for (auto& row : mResourceRows)
+					if (row.mResource != nullptr)
+						rows.emplace_back(row.mResource);
+				for (auto& row : mEntityRows)
+					if (row.mResource != nullptr)
+						rows.emplace_back(row.mResource);
+				auto anchor = std::find_if(rows.begin(), rows.end(), [&](auto resource){ return resource->mID == mSelector->get(); });
+				auto clicked = std::find_if(rows.begin(), rows.end(), [&](auto resource){ return resource->mID == mID; });
+				if (anchor != rows.end() && clicked != rows.end())
+				{
+					auto lead = mSelector->get();
+					mSelector->clear();
+					auto first = std::min(anchor, clicked);
+					auto last = std::max(anchor, clicked);
+					for (auto it = first; it <= last; ++it)
+						mSelector->add((*it)->mID);
+					// Keep the anchor as the lead, so that the range can be changed with another shift-click
+					mSelector->add(lead);
+					return;
+				}
+			}
+
+			mSelector->set(mID);
+		}
+
+
+		Texture2D* ResourceList::getIcon(const rtti::TypeInfo& type)
+		{
+			if (type == RTTI_OF(Entity))
+				return mEntityIcon.get();
+			if (type.is_derived_from<IGroup>())
+				return mGroupIcon.get();
+			if (type.is_derived_from<Component>())
+				return mComponentIcon.get();
+			return mResourceIcon.get();
+		}
+
+
+		void ResourceList::rebuildRows()
+		{
+			if (isFiltering())
+				updateFilter();
+
+			mResourceRows.clear();
+			mEntityRows.clear();
+			switch (mViewMode)
+			{
+				case EViewMode::Tree:
+					flattenTree(mModel->getTree().mGroups, 0, mResourceRows);
+					flattenTree(mModel->getTree().mResources, 0, mResourceRows);
+					flattenTree(mModel->getTree().mEntities, 0, mEntityRows);
+					break;
+				case EViewMode::Name:
+					flattenOrder(mOrder.getByName(), false);
+					break;
+				case EViewMode::Type:
+					flattenOrder(mOrder.getByType(), false);
+					break;
+				case EViewMode::GroupByType:
+					flattenOrder(mOrder.getByType(), true);
+					break;
+				case EViewMode::Recent:
+					flattenOrder(mOrder.getRecent(), false);
+					break;
+			}
+
+			mRowsGeneration = mModel->getTreeGeneration();
+			mRowsOrderVersion = mOrder.getVersion();
+			mRowsDirty = false;
+		}
+
+
+		void ResourceList::flattenOrder(const std::vector<Resource*>& order, bool groupByType)
+		{
+			// Which resources are in which section only changes with the tree
+			if (!mSectionsValid || mSectionsGeneration != mModel->getTreeGeneration())
+			{
+				mResourceSection.clear();
+				mEntitySection.clear();
+				collectTree(mModel->getTree().mGroups, mResourceSection);
+				collectTree(mModel->getTree().mResources, mResourceSection);
+				collectTree(mModel->getTree().mEntities, mEntitySection);
+				mSectionsGeneration = mModel->getTreeGeneration();
+				mSectionsValid = true;
+			}
+
+			for (auto resource : order)
+			{
+				if (isFiltering() && !isMatched(resource))
+					continue;
+				bool inResources = mResourceSection.find(resource) != mResourceSection.end();
+				if (!inResources && mEntitySection.find(resource) == mEntitySection.end())
+					continue;
+
+				auto& rows = inResources ? mResourceRows : mEntityRows;
+				auto type = resource->get_type();
+				int depth = 0;
+				if (groupByType)
+				{
+					// The order is sorted by type, so a new type starts a new group
+					if (rows.empty() || rows.back().mTypeName != type.get_name())
+						rows.push_back({ nullptr, 0, false, nullptr, type.get_name() });
+					depth = 1;
+				}
+				rows.push_back({ resource, depth, false, getIcon(type), type.get_name() });
+			}
+		}
+
+
+		void ResourceList::updateFilter()
+		{
+			// Cache the lower case ids, they only change when resources are added, removed or renamed
+			if (mSlotsGeneration != mModel->getStructureGeneration() || mLowerCaseIDs.empty())
+			{
+				auto& resources = mModel->getResources();
+				mSlots.clear();
+				mSlots.reserve(resources.size());
+				mLowerCaseIDs.resize(resources.size());
+				for (auto i = 0; i < resources.size(); ++i)
+				{
+					mSlots.emplace(resources[i].get(), i);
+					mLowerCaseIDs[i] = utility::toLower(resources[i]->mID);
+				}
+				mSlotsGeneration = mModel->getStructureGeneration();
+				mAppliedFilter.clear();
+				mFilterValid = false;
+			}
+
+			auto filter = utility::toLower(mSearchFilter);
+			bool matchesChanged = filter != mAppliedFilter || !mFilterValid;
+			if (matchesChanged && mSearchValues)
+			{
+				mMatched.assign(mLowerCaseIDs.size(), false);
+				mMatches.clear();
+				for (auto& mID : mValueResults)
+				{
+					auto slot = mSlots.find(mModel->findResource(mID));
+					if (slot != mSlots.end())
+					{
+						mMatched[slot->second] = true;
+						mMatches.emplace_back(slot->second);
+					}
+				}
+
+				mAppliedFilter = filter;
+				mFilterValid = true;
+			}
+			else if (matchesChanged)
+			{
+				// Appending characters can only remove matches, so only the previous matches are tested again
+				bool refine = mFilterValid && !mAppliedFilter.empty() && filter.compare(0, mAppliedFilter.size(), mAppliedFilter) == 0;
+				if (!refine)
+				{
+					mMatches.resize(mLowerCaseIDs.size());
+					std::iota(mMatches.begin(), mMatches.end(), 0);
+				}
+				mMatched.assign(mLowerCaseIDs.size(), false);
+				mMatches.erase(std::remove_if(mMatches.begin(), mMatches.end(), [&](int slot)
+				{
+					return mLowerCaseIDs[slot].find(filter) == std::string::npos;
+				}), mMatches.end());
+				for (auto slot : mMatches)
+					mMatched[slot] = true;
+
+				mAppliedFilter = filter;
+				mFilterValid = true;
+			}
+
+			// Groups and entities are shown when they contain a match, which depends on the tree
+			if (matchesChanged || mFilterGeneration != mModel->getTreeGeneration())
+			{
+				mFiltered.assign(mLowerCaseIDs.size(), false);
+				filterTree(mModel->getTree().mResources);
+				filterTree(mModel->getTree().mGroups);
+				filterTree(mModel->getTree().mEntities);
+				mFilterGeneration = mModel->getTreeGeneration();
+			}
+		}
+
+
+		void ResourceList::drawFindReplace()
+		{
+			// Matches are searched again whenever a setting changes
+			bool changed = ImGui::InputText("Find", mFindBuffer, sizeof(mFindBuffer));
+			changed |= ImGui::InputText("Replace with", mReplaceBuffer, sizeof(mReplaceBuffer));
+			changed |= ImGui::Checkbox("Match case", &mFindMatchCase);
+			ImGui::SameLine();
+			changed |= ImGui::Checkbox("Numbers and enums", &mFindNumbers);
+			if (changed)
+				mFindReplace.scan(*mModel, mFindBuffer, mReplaceBuffer, mFindMatchCase, mFindNumbers);
+
+			// Preview of all matches, only the visible rows are drawn
+			auto& matches = mFindReplace.getMatches();
+			ImGui::Text("%d matches", int(matches.size()));
+			ImGui::BeginChild("##FindReplaceMatches", ImVec2(600.f * mGuiService->getScale(), 300.f * mGuiService->getScale()), true);
+			ImGuiListClipper clipper;
+			clipper.Begin(matches.size());
+			while (clipper.Step())
+			{
+				for (auto i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+				{
+					auto& match = matches[i];
+					ImGui::PushID(i);
+					ImGui::Checkbox("##Enabled", &match.mEnabled);
+					ImGui::SameLine();
+					if (match.mArrayIndex < 0)
+						ImGui::Text("%s/%s: %s -> %s", match.mID.c_str(), match.mPath.toString().c_str(), match.mOldText.c_str(), match.mNewText.c_str());
+					else
+						ImGui::Text("%s/%s/%d: %s -> %s", match.mID.c_str(), match.mPath.toString().c_str(), match.mArrayIndex, match.mOldText.c_str(), match.mNewText.c_str());
+					ImGui::PopID();
+				}
+			}
+			ImGui::EndChild();
+
+			if (ImGui::Button("Replace") && !matches.empty())
+			{
+				int count = mFindReplace.apply(*mController);
+				Logger::info("Replaced %d values", count);
+				ImGui::CloseCurrentPopup();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Cancel"))
+			{
+				mFindReplace.clear();
+				ImGui::CloseCurrentPopup();
+			}
+		}
+
+
+		bool ResourceList::isFiltered(const Resource* resource) const
+		{
+			auto slot = mSlots.find(resource);
+			return slot != mSlots.end() && mFiltered[slot->second];
+		}
+
+
+		bool ResourceList::isMatched(const Resource* resource) const
+		{
+			auto slot = mSlots.find(resource);
+			return slot != mSlots.end() && mMatched[slot->second];
+		}
+
+
+		void ResourceList::drawRows(const std::vector<Row>& rows)
+		{
+			ImGuiListClipper clipper;
+			clipper.Begin(rows.size());
+			while (clipper.Step())
+			{
+				for (auto i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+				{
+					// Entities can be listed more than once, as a child and in the root, so rows are identified by index
+					ImGui::PushID(i);
+					drawRow(rows[i]);
+					ImGui::PopID();
+				}
+			}
+		}
+
+
+		void ResourceList::drawRow(const Row& row)
+		{
+			auto resource = row.mResource;
+			auto nameOffset = mNameColumnOffset + mLayoutConstants->nameColumnIndent() * (row.mDepth + 1);
+
+			// Header of a group of resources of the same type
+			if (resource == nullptr)
+			{
+				ImGui::SetCursorPosX(nameOffset);
+				ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+				ImGui::TextUnformatted(row.mTypeName.data(), row.mTypeName.data() + row.mTypeName.size());
+				ImGui::PopStyleColor();
+				return;
+			}
+
+			// For groups or entities draw the tree node arrow.
+			if (row.mExpandable)
+			{
+				ImGui::SetCursorPosX(nameOffset + mLayoutConstants->treeNodeArrowShift());
+				bool opened = mExpanded.find(resource) != mExpanded.end();
+				if (TreeNodeArrow("###TreeNodeArrow", opened))
+				{
+					if (opened)
+						mExpanded.emplace(resource);
+					else
+						mExpanded.erase(resource);
+					mRowsDirty = true;
+				}
+				ImGui::SameLine();
+			}
+			else
+				ImGui::SetCursorPosX(nameOffset);
+
+			// draw icon
+			Icon(*row.mIcon, mGuiService);
+			ImGui::SameLine();
+
+			// If this node resource is selected and the user is renaming it, then the input field is focused.
+			if (mSelector->get() == resource->mID && mStartEditing)
+			{
+				mEditedID = resource->mID;
+				mStartEditing = false;
+				mEnteredID.clear();
+				strcpy(mRenameBuffer, mEditedID.c_str());
+				ImGui::SetKeyboardFocusHere();
+			}
+
+			// If this resource is being renamed, draw the text input field.
+			if (mEditedID == resource->mID)
+			{
+				ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
+				ImGui::SetNextItemWidth(mTypeColumnOffset - mNameColumnOffset - ImGui::GetCursorPosX());
+				if (ImGui::InputText("###RenameInput", mRenameBuffer, sizeof(mRenameBuffer), ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll))
+					mEnteredID = mRenameBuffer;
+				ImGui::PopStyleVar();
+			}
+
+			// If not being renamed, draw the text label.
+			else {
+				if (Selectable(resource->mID.c_str(), mSelector->contains(resource->mID), mTypeColumnOffset - mNameColumnOffset - ImGui::GetCursorPosX() - 10 * mGuiService->getScale()))
+				{
+					select(resource->mID);
+					mEditedID.clear();
+				}
+
+				// Drag the selection, components stay with their entity
+				if (!resource->get_type().is_derived_from<Component>() && ImGui::BeginDragDropSource())
+				{
+					if (!mSelector->contains(resource->mID))
+						mSelector->set(resource->mID);
+					ImGui::SetDragDropPayload(sDragDropPayload, nullptr, 0);
+					if (mSelector->size() > 1)
+						ImGui::Text("%d resources", mSelector->size());
+					else
+						ImGui::TextUnformatted(resource->mID.c_str());
+					ImGui::EndDragDropSource();
+				}
+
+				// Groups and entities accept dropped resources, the drop is applied after the tree has been drawn
+				if (row.mExpandable)
+					acceptDrop(resource->mID);
+				// Check if the user double clicked on the resource name.
+				if (ImGui::IsItemHovered())
+					if (ImGui::IsMouseDoubleClicked(0))
+						mStartEditing = true;
+			}
+
+			// Draw the type name, directly from the name kept by rtti
+			ImGui::SameLine();
+			ImGui::SetCursorPosX(mTypeColumnOffset);
+			ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
+			ImGui::TextUnformatted(row.mTypeName.data(), row.mTypeName.data() + row.mTypeName.size());
+			ImGui::PopStyleColor();
+		}
+
+
+		void ResourceList::acceptDrop(const std::string& targetID)
+		{
+			if (ImGui::BeginDragDropTarget())
+			{
+				if (ImGui::AcceptDragDropPayload(sDragDropPayload) != nullptr)
+				{
+					mDropTargetID = targetID;
+					mDropPending = true;
+				}
+				ImGui::EndDragDropTarget();
+			}
+		}
+
+
+		void ResourceList::applyDrop()
+		{
+			mDropPending = false;
+			auto selection = mSelector->getAll();
+			auto targetEntity = mDropTargetID.empty() ? nullptr : mModel->findResource<Entity>(mDropTargetID);
+			if (targetEntity == nullptr)
+			{
+				mController->moveResources(selection, mDropTargetID);
+				return;
+			}
+
+			// Entities dropped on an entity become its children, as one undo step
+			mController->beginTransaction();
+			for (auto& mID : selection)
+			{
+				auto entity = mModel->findResource<Entity>(mID);
+				if (entity != nullptr && entity != targetEntity)
+					mController->addChildEntity(mID, mDropTargetID);
+			}
+			mController->commitTransaction();
 		}
 	}
 }
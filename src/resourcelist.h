@@ -12,6 +12,11 @@
 #include <imguiservice.h>
 
 #include "controller.h"
+#include "resourceorder.h"
+#include "propertyindex.h"
+#include "findreplace.h"
+
+#include <unordered_set>
 
 namespace nap
 {
@@ -46,33 +51,136 @@ namespace nap
 			void draw() override;
 
 			/**
-			 * Draws a tree branch of the resource tree.
-			 * This function is called recursively to draw sub branches.
+			 * Ways to present the resources.
+			 */
+			enum class EViewMode : int
+			{
+				Tree,			// The tree of the model
+				Name,			// Flat list sorted by mID
+				Type,			// Flat list sorted by type
+				GroupByType,	// Flat list with a header row for every type
+				Recent			// Flat list with the most recently edited resources first
+			};
+
+			/**
+			 * A row of the resource tree as it is drawn.
+			 */
+			struct Row
+			{
+				Resource* mResource = nullptr;	// Resource drawn in the row, nullptr for a type header row
+				int mDepth = 0;					// Depth within the tree, 0 for the top level
+				bool mExpandable = false;		// Whether the row is a group or entity that can be expanded
+				Texture2D* mIcon = nullptr;		// Icon for the type of the resource
+				rttr::string_view mTypeName;	// Name of the type of the resource, owned by rtti
+			};
+
+			/**
+			 * Flattens a tree branch into the rows that are visible: the resources that pass the filter, and the contents of expanded groups and entities.
+			 * This function is called recursively to flatten sub branches.
 			 * @tparam T Type of the resources in the branch.
 			 * @param branch Vector of resources in the branch.
-			 * @param nameOffset Horizontal offset of the name column of the current (sub) branch. This offset increases with the depth within the tree.
+			 * @param depth Depth of the branch within the tree.
+			 * @param rows Receives the rows.
 			 */
 			template <typename T>
-			void drawTree(const std::vector<ResourcePtr<T>>& branch, float nameOffset);
+			void flattenTree(const std::vector<ResourcePtr<T>>& branch, int depth, std::vector<Row>& rows);
 
 			/**
-			 * Filters a tree branch of the resource tree.
+			 * @return The icon shown for resources of the given type.
+			 */
+			Texture2D* getIcon(const rtti::TypeInfo& type);
+
+			/**
+			 * Collects all resources in a tree branch, including the contents of groups and entities.
+			 * This function is called recursively to collect sub branches.
+			 */
+			template <typename T>
+			void collectTree(const std::vector<ResourcePtr<T>>& branch, std::unordered_set<const Resource*>& resources);
+
+			/**
+			 * Builds the rows of the flat views from a maintained order. Each resource goes to the section of the tree it is in, embedded objects are left out.
+			 * @param order Resources in the order to present them.
+			 * @param groupByType Whether to add a header row for every type.
+			 */
+			void flattenOrder(const std::vector<Resource*>& order, bool groupByType);
+
+			/**
+			 * Rebuilds the visible rows and the filtered resources, called when the tree, the filter or the expansion state has changed.
+			 */
+			void rebuildRows();
+
+			/**
+			 * Draws the rows that are within the scroll view, the other rows are skipped.
+			 */
+			void drawRows(const std::vector<Row>& rows);
+
+			/**
+			 * Draws a single row of the resource tree.
+			 */
+			void drawRow(const Row& row);
+
+			/**
+			 * Marks the resources in a tree branch that are shown while filtering: resources that match the filter and the groups and entities that contain them.
 			 * This function is called recursively to filter sub branches.
 			 * @tparam T Type of the resources in the branch.
-			 * @param filter Lower case filter string.
 			 * @param branch Vector of resources in the branch.
-			 * @param filteredResources Set of resources that have been filtered. This set is modified by this function.
-			 * @return True if any resource in the branch has been filtered, false otherwise.
+			 * @return True if any resource in the branch is shown, false otherwise.
 			 */
 			template <typename T>
-			bool filterTree(const std::string& filter, const std::vector<ResourcePtr<T>>& branch, std::set<Resource*>& filteredResources);
+			bool filterTree(const std::vector<ResourcePtr<T>>& branch);
+
+			/**
+			 * Brings the filter result up to date with the search filter and the model.
+			 * Lower case ids are cached until resources are added, removed or renamed.
+			 * When characters are appended to the filter only the previous matches are tested again.
+			 */
+			void updateFilter();
+
+			/**
+			 * @return Whether the resource is shown while filtering.
+			 */
+			bool isFiltered(const Resource* resource) const;
+
+			/**
+			 * @return Whether the mID of the resource contains the filter.
+			 */
+			bool isMatched(const Resource* resource) const;
+
+			/**
+			 * Handles a click on a resource: ctrl toggles the resource, shift selects the range of rows from the lead selection, otherwise the resource is selected alone.
+			 */
+			void select(const std::string& mID);
+
+			/**
+			 * Makes the last drawn item a drop target for dragged resources.
+			 * @param targetID ID of the group or entity to drop on, empty for the root of the resources tree.
+			 */
+			void acceptDrop(const std::string& targetID);
+
+			/**
+			 * Moves the selected resources to the drop target, called after the tree has been drawn.
+			 */
+			void applyDrop();
+
+			/**
+			 * Draws the contents of the find and replace popup: the search settings, the list of matches and the replace button.
+			 */
+			void drawFindReplace();
 
 			/**
 			 * @return True if a filter is applied to the resource tree.
 			 */
 			bool isFiltering() const { return mSearchFilter[0] != '\0'; }
 
+			// Forget the expansion state of removed resources, so that the set does not grow and a new resource at the same address starts collapsed
+			Slot<const std::string&> mResourceRemovedSlot = { this, &ResourceList::onResourceRemoved };
+			void onResourceRemoved(const std::string& mID);
+			Slot<> mClearedSlot = { this, &ResourceList::onCleared };
+			void onCleared();
+
 			char mRenameBuffer[128]; // Buffer for renaming a resource.
+			char mLabelBuffer[256]; // Buffer for composed menu labels, so that drawing does not allocate.
+			uint64_t mFrameAllocations = 0; // Heap allocations during the last draw, counted when NAPEDIT_COUNT_ALLOCATIONS is defined.
 
 			std::string mEditedID; // mID of the resource that is being renamed.
 			std::string mEnteredID; // New mID that has been entered for the mID that is being renamed (stored in mEditedID)
@@ -86,8 +194,46 @@ namespace nap
 			bool mResourcesNodeSelected = false;
 			bool mEntitiesNodeSelected = false;
 
-			std::set<Resource*> mFilteredResources; // Resources that have been filtered by the search filter.
-			char mSearchFilter[128];				// Search filter string.
+			int mCopyCount = 10;					// Number of copies to create from the template
+			char mCopyPattern[128];					// Naming pattern for the copies, '#' is replaced by a number
+			std::string mCopyTemplateID;			// Resource the copies are created from
+			std::string mCopyParentID;				// Group or entity the copies are added to
+
+			FindReplace mFindReplace;				// Matches of the find and replace dialog
+			char mFindBuffer[128];					// Text to find in property values
+			char mReplaceBuffer[128];				// Text to replace it with
+			bool mFindMatchCase = false;
+			bool mFindNumbers = false;				// Whether numbers and enums are included in the find and replace
+
+			std::vector<Row> mResourceRows;					// Visible rows under the resources node
+			std::vector<Row> mEntityRows;					// Visible rows under the entities node
+			std::unordered_set<const Resource*> mExpanded;	// Groups and entities that are expanded
+			uint64_t mRowsGeneration = 0;					// Tree generation of the model the rows were built from
+			uint64_t mRowsOrderVersion = 0;					// Version of mOrder the rows were built from
+			EViewMode mViewMode = EViewMode::Tree;
+			ResourceOrder mOrder;							// Orders of the flat views, maintained from model changes
+			std::unordered_set<const Resource*> mResourceSection;	// Resources under the resources node, used by the flat views
+			std::unordered_set<const Resource*> mEntitySection;		// Resources under the entities node, used by the flat views
+			uint64_t mSectionsGeneration = 0;				// Tree generation of the model the sections were collected from
+			bool mSectionsValid = false;
+			bool mRowsDirty = true;							// Whether the rows need to be rebuilt before drawing
+			std::string mDropTargetID;				// Group or entity the selection was dropped on, empty for the root
+			bool mDropPending = false;
+			static constexpr const char* sDragDropPayload = "NAP_EDIT_RESOURCES";
+
+			char mSearchFilter[128];							// Search filter string.
+			std::string mAppliedFilter;							// Lower case filter the matches were computed for
+			std::unordered_map<const Resource*, int> mSlots;	// Slot of every resource in the filter cache
+			std::vector<std::string> mLowerCaseIDs;				// Lower case mID by slot
+			std::vector<int> mMatches;							// Slots of the resources whose mID contains the filter
+			std::vector<uint8_t> mMatched;						// Whether the resource matches the filter, by slot
+			std::vector<uint8_t> mFiltered;						// Whether the resource is shown while filtering, by slot
+			uint64_t mSlotsGeneration = 0;						// Structure generation of the model the slots were built for
+			uint64_t mFilterGeneration = 0;						// Tree generation of the model mFiltered was computed for
+			bool mFilterValid = false;							// Whether mFiltered was computed for mAppliedFilter
+			bool mSearchValues = false;							// Whether the filter searches property values instead of mIDs
+			PropertyIndex mPropertyIndex;						// Index of the property values, searched when mSearchValues is set
+			std::vector<std::string> mValueResults;				// mIDs of the resources with a property value that matches the filter
 
 			Core& mCore;
 			ResourcePtr<Model> mModel;
@@ -96,139 +242,103 @@ namespace nap
 
 
 		template <typename T>
-		void ResourceList::drawTree(const std::vector<ResourcePtr<T>>& branch, float nameOffset)
+		void ResourceList::flattenTree(const std::vector<ResourcePtr<T>>& branch, int depth, std::vector<Row>& rows)
 		{
 			for (auto& resource : branch)
 			{
 				// Apply search filter
-				if (isFiltering())
-					if (mFilteredResources.find(resource.get()) == mFilteredResources.end())
-						continue;
+				if (isFiltering() && !isFiltered(resource.get()))
+					continue;
 
-				bool opened = false;
-				// For groups or entities draw the tree node arrow.
-				if (resource->get_type().template is_derived_from<IGroup>() || resource->get_type().template is_derived_from<Entity>())
-				{
-					ImGui::SetCursorPosX(nameOffset + mLayoutConstants->treeNodeArrowShift());
-					std::string label = "###" + resource->mID;
-					opened = TreeNodeArrow(label.c_str());
-					ImGui::SameLine();
-				}
-				else
-					ImGui::SetCursorPosX(nameOffset);
-
-				// draw icon
-				if (resource->get_type() == RTTI_OF(Entity))
-					Icon(*mEntityIcon, mGuiService);
-				else if (resource->get_type().template is_derived_from<IGroup>())
-					Icon(*mGroupIcon, mGuiService);
-				else if (resource->get_type().template is_derived_from<Component>())
-					Icon(*mComponentIcon, mGuiService);
-				else
-					Icon(*mResourceIcon, mGuiService);
-				ImGui::SameLine();
-
-				// If this node resource is selected and the user is renaming it, then the input field is focused.
-				if (mSelector->get() == resource->mID && mStartEditing)
+				auto type = resource->get_type();
+				bool expandable = type.template is_derived_from<IGroup>() || type.template is_derived_from<Entity>();
+				rows.push_back({ resource.get(), depth, expandable, getIcon(type), type.get_name() });
+				if (!expandable || mExpanded.find(resource.get()) == mExpanded.end())
+					continue;
+
+				// The contents of expanded nodes follow the node
+				IGroup* igroup = rtti_cast<IGroup>(resource.get());
+				if (igroup != nullptr)
 				{
-					mEditedID = resource->mID;
-					mStartEditing = false;
-					mEnteredID.clear();
-					strcpy(mRenameBuffer, mEditedID.c_str());
-					ImGui::SetKeyboardFocusHere();
+					auto group = static_cast<ResourceGroup*>(igroup);
+					flattenTree(group->mMembers, depth + 1, rows);
+					flattenTree(group->mChildren, depth + 1, rows);
 				}
 
-				// If this resource is being renamed, draw the text input field.
-				if (mEditedID == resource->mID)
+				Entity* entity = rtti_cast<Entity>(resource.get());
+				if (entity != nullptr)
 				{
-					ImGui::PushStyleVar(ImGuiStyleVar_FramePadding, ImVec2(0, 0));
-					// ImGui::SetNextItemWidth((ImGui::GetWindowWidth() / 2) - ImGui::GetCursorPosX() - 10 * mGuiService->getScale());
-					ImGui::SetNextItemWidth(mTypeColumnOffset - mNameColumnOffset - ImGui::GetCursorPosX());
-					if (ImGui::InputText("###RenameInput", mRenameBuffer, sizeof(mRenameBuffer), ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll))
-						mEnteredID = mRenameBuffer;
-					ImGui::PopStyleVar();
+					flattenTree(entity->mComponents, depth + 1, rows);
+					flattenTree(entity->mChildren, depth + 1, rows);
 				}
+			}
+		}
+
 
-				// If not being renamed, draw the text label.
-				else {
-					if (Selectable(resource->mID.c_str(), mSelector->get() == resource->mID, mTypeColumnOffset - mNameColumnOffset - ImGui::GetCursorPosX() - 10 * mGuiService->getScale()))
-					{
-						mSelector->set(resource->mID);
-						mEditedID.clear();
-					}
-					// Check if the user double clicked on the resource name.
-					if (ImGui::IsItemHovered())
-						if (ImGui::IsMouseDoubleClicked(0))
-							mStartEditing = true;
+		template <typename T>
+		void ResourceList::collectTree(const std::vector<ResourcePtr<T>>& branch, std::unordered_set<const Resource*>& resources)
+		{
+			for (auto& resource : branch)
+			{
+				resources.emplace(resource.get());
+
+				IGroup* igroup = rtti_cast<IGroup>(resource.get());
+				if (igroup != nullptr)
+				{
+					auto group = static_cast<ResourceGroup*>(igroup);
+					collectTree(group->mMembers, resources);
+					collectTree(group->mChildren, resources);
 				}
 
-				// Draw the type name
-				auto type = resource->get_type();
-				ImGui::SameLine();
-				ImGui::SetCursorPosX(mTypeColumnOffset);
-				ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32(ImGuiCol_TextDisabled));
-				ImGui::Text(type.get_name().to_string().c_str());
-				ImGui::PopStyleColor();
-
-				// If the tree node is opened, draw the sub tree.
-				if (opened)
+				Entity* entity = rtti_cast<Entity>(resource.get());
+				if (entity != nullptr)
 				{
-					IGroup* igroup = rtti_cast<IGroup>(resource.get());
-					if (igroup != nullptr)
-					{
-						auto group = static_cast<ResourceGroup*>(igroup);
-						drawTree(group->mMembers, nameOffset + mLayoutConstants->nameColumnIndent());
-						drawTree(group->mChildren, nameOffset + mLayoutConstants->nameColumnIndent());
-					}
-
-					Entity* entity = rtti_cast<Entity>(resource.get());
-					if (entity != nullptr)
-					{
-						drawTree(entity->mComponents, nameOffset + mLayoutConstants->nameColumnIndent());
-						drawTree(entity->mChildren, nameOffset + mLayoutConstants->nameColumnIndent());
-					}
-					ImGui::TreePop();
+					collectTree(entity->mComponents, resources);
+					collectTree(entity->mChildren, resources);
 				}
 			}
 		}
 
 
 		template<typename T>
-		bool ResourceList::filterTree(const std::string &lowerCaseFilter, const std::vector<ResourcePtr<T>> &branch, std::set<Resource*> &filteredResources)
+		bool ResourceList::filterTree(const std::vector<ResourcePtr<T>> &branch)
 		{
 			bool result = false;
 			for (auto &resource : branch)
 			{
-				std::string lowerID = resource->mID;
-				utility::toLower(lowerID);
-				if (lowerID.find(lowerCaseFilter) != std::string::npos)
-				{
-					filteredResources.emplace(resource.get());
-					result = true;
-				}
+				auto slot = mSlots.find(resource.get());
+				if (slot == mSlots.end())
+					continue;
+				bool shown = mMatched[slot->second];
 
 				IGroup* igroup = rtti_cast<IGroup>(resource.get());
 				if (igroup != nullptr)
 				{
 					auto group = static_cast<ResourceGroup*>(igroup);
-					if (filterTree(lowerCaseFilter, group->mMembers, filteredResources))
-						result = true;
-					if (filterTree(lowerCaseFilter, group->mChildren, filteredResources))
-						result = true;
+					if (filterTree(group->mMembers))
+						shown = true;
+					if (filterTree(group->mChildren))
+						shown = true;
 				}
 
 				Entity* entity = rtti_cast<Entity>(resource.get());
 				if (entity != nullptr)
 				{
-					if (filterTree(lowerCaseFilter, entity->mComponents, filteredResources))
-						result = true;
-					if (filterTree(lowerCaseFilter, entity->mChildren, filteredResources))
-						result = true;
+					if (filterTree(entity->mComponents))
+						shown = true;
+					if (filterTree(entity->mChildren))
+						shown = true;
+				}
+
+				// Groups and entities are shown when they contain a match, so that the match can be reached
+				if (shown)
+				{
+					mFiltered[slot->second] = true;
+					result = true;
 				}
 			}
 			return result;
 		}
 
-
 	}
 }
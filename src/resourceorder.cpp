@@ -0,0 +1,189 @@
+#include "resourceorder.h"
+
+#include <algorithm>
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			bool lessByName(const Resource* a, const Resource* b)
+			{
+				return a->mID < b->mID;
+			}
+
+
+			bool lessByType(const Resource* a, const Resource* b)
+			{
+				auto typeA = a->get_type().get_name();
+				auto typeB = b->get_type().get_name();
+				if (typeA != typeB)
+					return typeA < typeB;
+				return a->mID < b->mID;
+			}
+		}
+
+
+		void ResourceOrder::init(Model& model)
+		{
+			mModel = &model;
+			mModel->mResourceAddedSignal.connect(mAddedSlot);
+			mModel->mResourceRemovedSignal.connect(mRemovedSlot);
+			mModel->mResourceRenamedSignal.connect(mRenamedSlot);
+			mModel->mResourceEditedSignal.connect(mEditedSlot);
+			mModel->mClearedSignal.connect(mClearedSlot);
+			mModel->mChangedSignal.connect(mChangedSlot);
+
+			onCleared();
+			for (auto& resource : mModel->getResources())
+				mAdded.emplace_back(resource.get());
+			mRecent = mAdded;
+		}
+
+
+		const std::vector<Resource*>& ResourceOrder::getByName()
+		{
+			update();
+			return mByName;
+		}
+
+
+		const std::vector<Resource*>& ResourceOrder::getByType()
+		{
+			update();
+			return mByType;
+		}
+
+
+		const std::vector<Resource*>& ResourceOrder::getRecent()
+		{
+			update();
+			return mRecent;
+		}
+
+
+		void ResourceOrder::update()
+		{
+			if (!mRemoved.empty())
+			{
+				auto removed = [this](const Resource* resource){ return mRemoved.find(resource) != mRemoved.end(); };
+				mByName.erase(std::remove_if(mByName.begin(), mByName.end(), removed), mByName.end());
+				mByType.erase(std::remove_if(mByType.begin(), mByType.end(), removed), mByType.end());
+				mRecent.erase(std::remove_if(mRecent.begin(), mRecent.end(), removed), mRecent.end());
+				mAdded.erase(std::remove_if(mAdded.begin(), mAdded.end(), removed), mAdded.end());
+				mEdited.erase(std::remove_if(mEdited.begin(), mEdited.end(), removed), mEdited.end());
+				mRemoved.clear();
+			}
+
+			if (!mEdited.empty())
+			{
+				// Rebuild the recent order with the edited resources in front, the most recent edit first
+				std::unordered_set<const Resource*> moved;
+				std::vector<Resource*> recent;
+				recent.reserve(mRecent.size() + mEdited.size());
+				for (auto it = mEdited.rbegin(); it != mEdited.rend(); ++it)
+					if (moved.emplace(*it).second)
+						recent.emplace_back(*it);
+				for (auto resource : mRecent)
+					if (moved.find(resource) == moved.end())
+						recent.emplace_back(resource);
+				mRecent = std::move(recent);
+				mEdited.clear();
+			}
+
+			if (!mAdded.empty())
+			{
+				// Sort the batch and merge it in, instead of sorting all resources again
+				auto merge = [this](std::vector<Resource*>& order, auto less)
+				{
+					std::sort(mAdded.begin(), mAdded.end(), less);
+					auto middle = order.size();
+					order.insert(order.end(), mAdded.begin(), mAdded.end());
+					std::inplace_merge(order.begin(), order.begin() + middle, order.end(), less);
+				};
+				merge(mByName, lessByName);
+				merge(mByType, lessByType);
+				mAdded.clear();
+			}
+		}
+
+
+		void ResourceOrder::erase(Resource* resource)
+		{
+			mByName.erase(std::remove(mByName.begin(), mByName.end(), resource), mByName.end());
+			mByType.erase(std::remove(mByType.begin(), mByType.end(), resource), mByType.end());
+			mAdded.erase(std::remove(mAdded.begin(), mAdded.end(), resource), mAdded.end());
+		}
+
+
+		void ResourceOrder::onResourceAdded(const std::string& mID)
+		{
+			auto resource = mModel->findResource(mID);
+			assert(resource != nullptr);
+
+			// A restored resource can reuse the address of a removed one that was not taken out yet
+			if (mRemoved.erase(resource) > 0)
+			{
+				erase(resource);
+				mRecent.erase(std::remove(mRecent.begin(), mRecent.end(), resource), mRecent.end());
+				mEdited.erase(std::remove(mEdited.begin(), mEdited.end(), resource), mEdited.end());
+			}
+			mAdded.emplace_back(resource);
+			mEdited.emplace_back(resource);
+			mVersion++;
+		}
+
+
+		void ResourceOrder::onResourceRemoved(const std::string& mID)
+		{
+			auto resource = mModel->findResource(mID);
+			if (resource == nullptr)
+				return;
+			mRemoved.emplace(resource);
+			mVersion++;
+		}
+
+
+		void ResourceOrder::onResourceRenamed(const std::string& oldID, const std::string& newID)
+		{
+			// Take the resource out of the sorted orders and merge it in again at its new position
+			auto resource = mModel->findResource(newID);
+			if (resource == nullptr)
+				return;
+			update();
+			erase(resource);
+			mAdded.emplace_back(resource);
+			mVersion++;
+		}
+
+
+		void ResourceOrder::onResourceEdited(const std::string& mID)
+		{
+			// Continuous edits hit the same resource every frame, which is already in front
+			auto resource = mModel->findResource(mID);
+			if (resource == nullptr)
+				return;
+			if (mEdited.empty() ? (!mRecent.empty() && mRecent.front() == resource) : mEdited.back() == resource)
+				return;
+			mEdited.emplace_back(resource);
+			mVersion++;
+		}
+
+
+		void ResourceOrder::onCleared()
+		{
+			mByName.clear();
+			mByType.clear();
+			mRecent.clear();
+			mAdded.clear();
+			mEdited.clear();
+			mRemoved.clear();
+			mVersion++;
+		}
+
+	}
+
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <model.h>
+
+#include <unordered_set>
+#include <vector>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Keeps the resources of a Model in alternative orders: by name, by type and by most recent edit.
+		 * The orders are sorted once and then maintained from the change signals of the model.
+		 * Added resources are merged in as one sorted batch, edited resources are moved to the front of the recent order in one pass and removed resources
+		 * are taken out in one pass, all after every command, also while no flat view requests an order. This keeps edits of many resources at once, like a find and replace, linear,
+		 * without letting pending changes and pointers to removed resources pile up.
+		 */
+		class NAPAPI ResourceOrder
+		{
+		public:
+			ResourceOrder() = default;
+			ResourceOrder(const ResourceOrder&) = delete;
+			ResourceOrder& operator=(const ResourceOrder&) = delete;
+
+			/**
+			 * Starts following the model, all resources currently in the model are ordered.
+			 */
+			void init(Model& model);
+
+			/**
+			 * @return All resources sorted by mID.
+			 */
+			const std::vector<Resource*>& getByName();
+
+			/**
+			 * @return All resources sorted by type name, resources of the same type sorted by mID.
+			 */
+			const std::vector<Resource*>& getByType();
+
+			/**
+			 * @return All resources, the most recently edited or added first.
+			 */
+			const std::vector<Resource*>& getRecent();
+
+			/**
+			 * @return Number that changes whenever one of the orders changes.
+			 */
+			uint64_t getVersion() const { return mVersion; }
+
+		private:
+			void update();
+			void erase(Resource* resource);
+
+			Slot<const std::string&> mAddedSlot = { this, &ResourceOrder::onResourceAdded };
+			void onResourceAdded(const std::string& mID);
+
+			Slot<const std::string&> mRemovedSlot = { this, &ResourceOrder::onResourceRemoved };
+			void onResourceRemoved(const std::string& mID);
+
+			Slot<const std::string&, const std::string&> mRenamedSlot = { this, &ResourceOrder::onResourceRenamed };
+			void onResourceRenamed(const std::string& oldID, const std::string& newID);
+
+			Slot<const std::string&> mEditedSlot = { this, &ResourceOrder::onResourceEdited };
+			void onResourceEdited(const std::string& mID);
+
+			Slot<> mClearedSlot = { this, &ResourceOrder::onCleared };
+			void onCleared();
+
+			Slot<> mChangedSlot = { this, &ResourceOrder::update };
+
+			Model* mModel = nullptr;
+			std::vector<Resource*> mByName;
+			std::vector<Resource*> mByType;
+			std::vector<Resource*> mRecent;					// Most recent first
+			std::vector<Resource*> mAdded;					// Added since the last update, not yet in the sorted orders
+			std::vector<Resource*> mEdited;					// Added or edited since the last update, not yet moved to the front of mRecent. Most recent last
+			std::unordered_set<const Resource*> mRemoved;	// Removed since the last update, still in the orders
+			uint64_t mVersion = 0;
+		};
+
+	}
+}
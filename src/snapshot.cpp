@@ -0,0 +1,265 @@
+#include "snapshot.h"
+#include "objectutils.h"
+
+#include <rtti/writer.h>
+#include <rtti/binarywriter.h>
+#include <rtti/binaryreader.h>
+#include <utility/memorystream.h>
+
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			// Collects the resource and all objects embedded in it, recursively
+			std::unordered_set<rtti::Object*> collectSubtree(rtti::Object& root)
+			{
+				std::unordered_set<rtti::Object*> subtree = { &root };
+				std::vector<rtti::Object*> pending = { &root };
+				while (!pending.empty())
+				{
+					auto object = pending.back();
+					pending.pop_back();
+					visitPointers(*object, [&](const rtti::Path&, int, bool isEmbedded, rtti::Object* target)
+					{
+						if (isEmbedded && subtree.emplace(target).second)
+							pending.emplace_back(target);
+					});
+				}
+				return subtree;
+			}
+		}
+
+
+		bool Snapshot::capture(Model& model, const std::string& mID, SpillStore& store, utility::ErrorState& errorState)
+		{
+			auto root = model.findResource(mID);
+			if (!errorState.check(root != nullptr, "Resource not found: %s", mID.c_str()))
+				return false;
+
+			auto subtree = collectSubtree(*root);
+			if (!serialize(model, *root, store, errorState))
+				return false;
+
+			// Collect all pointers from the rest of the model into the subtree
+			mLinks.clear();
+			for (auto& resource : model.getResources())
+			{
+				if (subtree.find(resource.get()) != subtree.end())
+					continue;
+				auto& sourceID = resource->mID;
+				visitPointers(*resource, [&](const rtti::Path& path, int arrayIndex, bool, rtti::Object* target)
+				{
+					if (subtree.find(target) != subtree.end())
+						mLinks.push_back({ sourceID, path, arrayIndex, target->mID });
+				});
+			}
+			return true;
+		}
+
+
+		bool Snapshot::capture(Model& model, const std::vector<std::string>& mIDs, SpillStore& store, std::vector<Snapshot>& snapshots, utility::ErrorState& errorState)
+		{
+			// Map every object in the subtrees to the index of the snapshot that captures it
+			std::vector<Resource*> roots;
+			std::unordered_map<rtti::Object*, int> owners;
+			for (auto& mID : mIDs)
+			{
+				auto root = model.findResource(mID);
+				if (!errorState.check(root != nullptr, "Resource not found: %s", mID.c_str()))
+					return false;
+				for (auto object : collectSubtree(*root))
+					owners.emplace(object, roots.size());
+				roots.emplace_back(root);
+			}
+
+			// Collect the pointers into all subtrees in a single pass over the model.
+			// Array elements are grouped per array, visitPointers reports them in ascending index order.
+			snapshots.clear();
+			snapshots.resize(roots.size());
+			std::unordered_map<std::string, std::vector<std::pair<int, size_t>>> arrays;
+			for (auto& resource : model.getResources())
+			{
+				auto source = owners.find(resource.get());
+				auto sourceIndex = source != owners.end() ? source->second : -1;
+				auto& sourceID = resource->mID;
+				visitPointers(*resource, [&](const rtti::Path& path, int arrayIndex, bool, rtti::Object* target)
+				{
+					auto owner = owners.find(target);
+					if (owner == owners.end() || owner->second == sourceIndex)
+						return;
+					auto& links = snapshots[owner->second].mLinks;
+					links.push_back({ sourceID, path, arrayIndex, target->mID });
+					if (arrayIndex >= 0)
+						arrays[sourceID + "/" + path.toString()].emplace_back(owner->second, links.size() - 1);
+				});
+			}
+
+			// The snapshots are unlinked one after the other, so an element is shifted down by the elements
+			// before it in the same array that belong to earlier snapshots. Those are counted with a Fenwick tree
+			// over the snapshots that own an element of the array.
+			for (auto& array : arrays)
+			{
+				auto& elements = array.second;
+				std::vector<int> ranks;
+				ranks.reserve(elements.size());
+				for (auto& element : elements)
+					ranks.emplace_back(element.first);
+				std::sort(ranks.begin(), ranks.end());
+				ranks.erase(std::unique(ranks.begin(), ranks.end()), ranks.end());
+
+				std::vector<int> counts(ranks.size() + 1, 0);
+				for (auto& element : elements)
+				{
+					auto rank = int(std::lower_bound(ranks.begin(), ranks.end(), element.first) - ranks.begin());
+					auto shift = 0;
+					for (auto i = rank; i > 0; i -= i & -i)
+						shift += counts[i];
+					snapshots[element.first].mLinks[element.second].mArrayIndex -= shift;
+					for (auto i = rank + 1; i < counts.size(); i += i & -i)
+						++counts[i];
+				}
+			}
+
+			// Serialize each subtree after unlinking the ones before it, so that it only contains pointers to resources restored before it
+			for (auto i = 0; i < snapshots.size(); ++i)
+			{
+				if (!snapshots[i].serialize(model, *roots[i], store, errorState))
+				{
+					for (auto j = i - 1; j >= 0; --j)
+						snapshots[j].relink(model);
+					return false;
+				}
+				snapshots[i].unlink(model);
+			}
+			return true;
+		}
+
+
+		bool Snapshot::serialize(Model& model, Resource& root, SpillStore& store, utility::ErrorState& errorState)
+		{
+			// Embedded objects are written as part of the object that embeds them
+			rtti::BinaryWriter writer;
+			std::vector<rtti::Object*> objects = { &root };
+			if (!serializeObjects(objects, writer, errorState))
+				return false;
+			mStore = &store;
+			mData = store.store(writer.getBuffer());
+			mRootID = root.mID;
+			mRootIndex = model.getRootIndex(root);
+			return true;
+		}
+
+
+		void Snapshot::unlink(Model& model) const
+		{
+			// Unlink in reverse order so that array indices of links that still need to be unlinked remain valid
+			for (auto it = mLinks.rbegin(); it != mLinks.rend(); ++it)
+			{
+				auto& link = *it;
+				auto source = model.findResource(link.mSourceID);
+				if (source == nullptr)
+					continue;
+				rtti::ResolvedPath resolvedPath;
+				if (!link.mPath.resolve(source, resolvedPath))
+					continue;
+
+				if (link.mArrayIndex >= 0)
+				{
+					auto array = resolvedPath.getValue();
+					auto view = array.create_array_view();
+					if (link.mArrayIndex < view.get_size())
+					{
+						view.remove_value(link.mArrayIndex);
+						resolvedPath.setValue(array);
+					}
+				}
+				else
+					resolvedPath.setValue(nullptr);
+			}
+		}
+
+
+		bool Snapshot::restore(Model& model, utility::ErrorState& errorState) const
+		{
+			auto data = mStore->load(*mData, errorState);
+			if (data == nullptr)
+				return false;
+
+			rtti::DeserializeResult result;
+			MemoryStream stream(data->data(), data->size());
+			if (!rtti::deserializeBinary(stream, model.getFactory(), result, errorState))
+				return false;
+
+			for (auto& object : result.mReadObjects)
+				if (!errorState.check(rtti_cast<Resource>(object.get()) != nullptr, "Object %s is not a resource", object->mID.c_str()))
+					return false;
+
+			// Hand ownership of all restored objects to the model
+			Resource* root = nullptr;
+			for (auto& object : result.mReadObjects)
+			{
+				auto resource = static_cast<Resource*>(object.release());
+				if (resource->mID == mRootID)
+					root = resource;
+				model.addEmbeddedObject(resource);
+			}
+			if (!errorState.check(root != nullptr, "Snapshot does not contain %s", mRootID.c_str()))
+				return false;
+
+			// Resolve pointers within the subtree and from the subtree to the rest of the model
+			for (auto& unresolvedPointer : result.mUnresolvedPointers)
+			{
+				auto target = model.findResource(unresolvedPointer.mTargetID);
+				if (target == nullptr)
+					continue; // The target has been removed since the snapshot was taken
+				rtti::ResolvedPath resolvedPath;
+				if (!errorState.check(unresolvedPointer.mRTTIPath.resolve(unresolvedPointer.mObject, resolvedPath), "Failed to resolve pointer: %s", unresolvedPointer.mRTTIPath.toString().c_str()))
+					return false;
+				resolvedPath.setValue(target);
+			}
+
+			// Put the resource back in its place in the tree, either in the root or through the links from its parent
+			if (mRootIndex >= 0)
+				model.insertIntoRoot(*root, mRootIndex);
+			relink(model);
+
+			return true;
+		}
+
+
+		void Snapshot::relink(Model& model) const
+		{
+			for (auto& link : mLinks)
+			{
+				auto source = model.findResource(link.mSourceID);
+				auto target = model.findResource(link.mTargetID);
+				if (source == nullptr || target == nullptr)
+					continue;
+				rtti::ResolvedPath resolvedPath;
+				if (!link.mPath.resolve(source, resolvedPath))
+					continue;
+
+				if (link.mArrayIndex >= 0)
+				{
+					auto array = resolvedPath.getValue();
+					auto view = array.create_array_view();
+					auto index = std::min<size_t>(link.mArrayIndex, view.get_size());
+					view.insert_value(index, target);
+					resolvedPath.setValue(array);
+				}
+				else
+					resolvedPath.setValue(target);
+			}
+		}
+
+	}
+
+}
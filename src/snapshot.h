@@ -0,0 +1,96 @@
+#pragma once
+
+#include <model.h>
+#include <spillstore.h>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Compact binary copy of a resource, all of its embedded objects, its position in the tree and all pointers to it from the rest of the Model.
+		 * Used to undo the removal of a resource exactly as it was, including its property values and embedded objects.
+		 * The subtree is stored using the rtti binary format, which is considerably denser and faster to read than JSON.
+		 */
+		class NAPAPI Snapshot
+		{
+		public:
+			Snapshot() = default;
+
+			/**
+			 * Captures the resource with the given mID and all objects embedded in it.
+			 * @param model Model that owns the resource.
+			 * @param mID mID of the resource to capture.
+			 * @param store Store that keeps the captured data, must outlive the snapshot.
+			 * @param errorState Contains the error when capturing fails.
+			 * @return True on success.
+			 */
+			bool capture(Model& model, const std::string& mID, SpillStore& store, utility::ErrorState& errorState);
+
+			/**
+			 * Captures multiple resources, collecting the pointers into all of them in a single pass over the model.
+			 * The snapshots are unlinked one after the other, so that each one only contains pointers to resources restored before it.
+			 * Restore them in reverse order.
+			 * @param model Model that owns the resources.
+			 * @param mIDs mIDs of the resources to capture, none of them can be embedded in another.
+			 * @param store Store that keeps the captured data, must outlive the snapshots.
+			 * @param snapshots Receives one unlinked snapshot per resource, in the order of mIDs.
+			 * @param errorState Contains the error when capturing fails, the model is left unchanged.
+			 * @return True on success.
+			 */
+			static bool capture(Model& model, const std::vector<std::string>& mIDs, SpillStore& store, std::vector<Snapshot>& snapshots, utility::ErrorState& errorState);
+
+			/**
+			 * Removes all pointers from outside the captured subtree into it.
+			 * Pointers in arrays are erased from the array, other pointers are set to null.
+			 * @param model Model that owns the captured resource.
+			 */
+			void unlink(Model& model) const;
+
+			/**
+			 * Restores all pointers from outside the captured subtree into it, the inverse of unlink().
+			 * @param model Model that owns the captured resource.
+			 */
+			void relink(Model& model) const;
+
+			/**
+			 * Recreates the captured resources in the model, places them back in the tree and restores all pointers to them.
+			 * @param model Model to restore the resources in.
+			 * @param errorState Contains the error when restoring fails.
+			 * @return True on success.
+			 */
+			bool restore(Model& model, utility::ErrorState& errorState) const;
+
+			/**
+			 * @return mID of the captured resource.
+			 */
+			const std::string& getRootID() const { return mRootID; }
+
+			/**
+			 * @return Size in bytes of the captured binary data.
+			 */
+			size_t getSize() const { return mData != nullptr ? mData->getSize() : 0; }
+
+		private:
+			// A pointer from outside the captured subtree into it
+			struct Link
+			{
+				std::string mSourceID;	// mID of the object containing the pointer
+				rtti::Path mPath;		// Path to the pointer, or to the array containing the pointer
+				int mArrayIndex = -1;	// Index of the pointer in the array, -1 if the pointer is not an array element
+				std::string mTargetID;	// mID of the object within the subtree the pointer points to
+			};
+
+			// Stores the subtree of root in binary format, together with its position in the tree
+			bool serialize(Model& model, Resource& root, SpillStore& store, utility::ErrorState& errorState);
+
+			std::string mRootID;
+			SpillStore* mStore = nullptr;
+			SpillStore::BlockPtr mData;	// Captured subtree in binary format
+			std::vector<Link> mLinks;	// Pointers into the subtree, in the order they appear in the model
+			int mRootIndex = -1;		// Index of the captured resource in the root of the tree, -1 when not in the root
+		};
+
+	}
+}
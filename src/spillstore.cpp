@@ -0,0 +1,161 @@
+#include "spillstore.h"
+
+#include <nap/logger.h>
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+namespace nap
+{
+
+	namespace edit
+	{
+
+		namespace
+		{
+			// A file in the temporary directory named after the process, so that editors running side by side never share a spill file
+			std::string getDefaultPath()
+			{
+#ifdef _WIN32
+				char directory[MAX_PATH + 1];
+				auto length = GetTempPathA(sizeof(directory), directory);
+				std::string path(directory, length > 0 && length < sizeof(directory) ? length : 0);
+				return path + "napedit-" + std::to_string(GetCurrentProcessId()) + ".undo";
+#else
+				auto directory = std::getenv("TMPDIR");
+				std::string path = directory != nullptr && directory[0] != '\0' ? directory : "/tmp";
+				if (path.back() != '/')
+					path += '/';
+				return path + "napedit-" + std::to_string(getpid()) + ".undo";
+#endif
+			}
+		}
+
+
+		SpillStore::Block::~Block()
+		{
+			if (mResident)
+				mStore.release(*this);
+		}
+
+
+		SpillStore::~SpillStore()
+		{
+			assert(mResident.empty());
+			if (mFile.is_open())
+			{
+				mFile.close();
+				std::remove(mPath.c_str());
+			}
+		}
+
+
+		void SpillStore::setBudget(size_t bytes)
+		{
+			mBudget = bytes;
+			spill();
+		}
+
+
+		SpillStore::BlockPtr SpillStore::store(std::vector<uint8_t> data)
+		{
+			auto block = std::make_shared<Block>(*this);
+			block->mSize = data.size();
+			block->mData = std::move(data);
+			makeResident(*block);
+			spill();
+			return block;
+		}
+
+
+		const std::vector<uint8_t>* SpillStore::load(Block& block, utility::ErrorState& errorState)
+		{
+			if (block.mResident)
+			{
+				// Mark as most recently used
+				mResident.splice(mResident.end(), mResident, block.mPosition);
+				return &block.mData;
+			}
+
+			assert(block.mOffset >= 0);
+			block.mData.resize(block.mSize);
+			mFile.seekg(block.mOffset);
+			if (!errorState.check(mFile.read(reinterpret_cast<char*>(block.mData.data()), block.mSize).good(), "Failed to read undo data from %s", mPath.c_str()))
+			{
+				mFile.clear();
+				block.mData = std::vector<uint8_t>();
+				return nullptr;
+			}
+
+			// Keep the block around, the user is likely to undo and redo around this point in the history
+			makeResident(block);
+			spill();
+			return &block.mData;
+		}
+
+
+		void SpillStore::makeResident(Block& block)
+		{
+			assert(!block.mResident);
+			block.mResident = true;
+			block.mPosition = mResident.insert(mResident.end(), &block);
+			mResidentSize += block.mSize;
+		}
+
+
+		void SpillStore::release(Block& block)
+		{
+			assert(block.mResident);
+			mResident.erase(block.mPosition);
+			mResidentSize -= block.mSize;
+			block.mResident = false;
+			block.mData = std::vector<uint8_t>();
+		}
+
+
+		void SpillStore::spill()
+		{
+			// Never spill the most recent block, it is the one being stored or loaded
+			while (mResidentSize > mBudget && mResident.size() > 1)
+			{
+				auto& block = *mResident.front();
+
+				// Blocks that were spilled before are still in the file, they only need to be released
+				if (block.mOffset < 0)
+				{
+					if (!mFile.is_open())
+					{
+						if (mPath.empty())
+							mPath = getDefaultPath();
+						mFile.open(mPath, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+					}
+					mFile.seekp(mFileSize);
+					if (!mFile.write(reinterpret_cast<const char*>(block.mData.data()), block.mSize))
+					{
+						// Keep everything in memory rather than losing history
+						Logger::error("Failed to spill undo data to %s", mPath.c_str());
+						mFile.clear();
+						return;
+					}
+					block.mOffset = mFileSize;
+					mFileSize += block.mSize;
+				}
+				release(block);
+			}
+			if (mFile.is_open())
+				mFile.flush();
+		}
+
+	}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <utility/dllexport.h>
+#include <utility/errorstate.h>
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace nap
+{
+	namespace edit
+	{
+
+		/**
+		 * Tiered storage for binary undo data.
+		 * Blocks stay in memory while the resident size is within the budget. When the budget is exceeded the least recently used
+		 * blocks are written to a spill file and released from memory. A spilled block is read back in transparently when it is loaded.
+		 * The spill file is append-only, every block is written at most once, and it is removed when the store is destroyed.
+		 * The store must outlive all blocks created by it.
+		 */
+		class NAPAPI SpillStore
+		{
+		public:
+			class Block
+			{
+				friend class SpillStore;
+			public:
+				Block(SpillStore& store) : mStore(store) { }
+				~Block();
+
+				/**
+				 * @return Size of the block in bytes.
+				 */
+				size_t getSize() const { return mSize; }
+
+				/**
+				 * @return True if the block is in memory.
+				 */
+				bool isResident() const { return mResident; }
+
+			private:
+				SpillStore& mStore;
+				std::vector<uint8_t> mData;						// Contents while resident
+				size_t mSize = 0;
+				int64_t mOffset = -1;							// Position in the spill file, -1 if never spilled
+				bool mResident = false;
+				std::list<Block*>::iterator mPosition;			// Position in SpillStore::mResident while resident
+			};
+			using BlockPtr = std::shared_ptr<Block>;
+
+			SpillStore() = default;
+			~SpillStore();
+			SpillStore(const SpillStore&) = delete;
+			SpillStore& operator=(const SpillStore&) = delete;
+
+			/**
+			 * Sets the maximum number of bytes kept in memory, spills blocks when the resident size exceeds it.
+			 */
+			void setBudget(size_t bytes);
+
+			/**
+			 * Sets the path of the spill file, used when the first block is spilled. The file is overwritten.
+			 * @param path Path of the spill file, empty to use a file in the temporary directory with the process id in its name.
+			 */
+			void setPath(const std::string& path) { mPath = path; }
+
+			/**
+			 * Stores data in a new block. May spill older blocks to stay within the budget.
+			 * @param data Contents of the block.
+			 * @return The new block.
+			 */
+			BlockPtr store(std::vector<uint8_t> data);
+
+			/**
+			 * Returns the contents of a block, reading it back from the spill file if it was spilled.
+			 * The block becomes the most recently used block. The returned data is valid until the next call to store() or load().
+			 * @param block The block to load.
+			 * @param errorState Contains the error when the block could not be read.
+			 * @return The contents of the block, nullptr on failure.
+			 */
+			const std::vector<uint8_t>* load(Block& block, utility::ErrorState& errorState);
+
+			/**
+			 * @return Number of bytes of all blocks currently in memory.
+			 */
+			size_t getResidentSize() const { return mResidentSize; }
+
+		private:
+			void makeResident(Block& block);
+			void release(Block& block);
+			void spill();
+
+			std::string mPath;					// Empty until the first spill when no path was set
+			std::fstream mFile;
+			int64_t mFileSize = 0;
+			size_t mBudget = 64 * 1024 * 1024;
+			size_t mResidentSize = 0;
+			std::list<Block*> mResident;		// Resident blocks, least recently used first
+		};
+
+	}
+}
@@ -13,6 +13,7 @@ RTTI_BEGIN_ENUM(nap::TestEnum)
 RTTI_END_ENUM
 
 RTTI_BEGIN_CLASS(nap::TestResource)
+    RTTI_PROPERTY("Path", &nap::TestResource::mPath, nap::rtti::EPropertyMetaData::Required)
     RTTI_PROPERTY("Struct", &nap::TestResource::mStruct, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("Enum", &nap::TestResource::mEnum, nap::rtti::EPropertyMetaData::Default)
     RTTI_PROPERTY("Vector", &nap::TestResource::mVector, nap::rtti::EPropertyMetaData::Default)
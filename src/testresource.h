@@ -29,6 +29,7 @@ namespace nap
     public:
         TestResource() = default;
 
+        std::string mPath;
         TestStruct mStruct;
         TestEnum mEnum = TestEnum::EEN;
         std::vector<int> mVector = { 1, 2, 3 };